@@ -8,6 +8,7 @@ Point::Point(size_t dimension, const float* features, const bool value)
 	this->dimension = dimension;
 	this-> value = value;
 	this->features = new float[dimension];
+	this->is_features_owned = true;
 	memcpy(this->features, features, dimension*sizeof(float));
 }
 
@@ -16,6 +17,7 @@ Point& Point::operator=(const Point& source)
 	this->dimension = source.dimension;
 	this-> value = source.value;
 	this->features = new float[source.dimension];
+	this->is_features_owned = true;
 	memcpy(this->features, source.features, source.dimension*sizeof(float));
 	return *this;
 }
@@ -43,12 +45,23 @@ Point::Point(const Point& source)
 	this->dimension = source.dimension;
 	this-> value = source.value;
 	this->features = new float[source.dimension];
+	this->is_features_owned = true;
+	memcpy(this->features, source.features, source.dimension*sizeof(float));
+}
+
+Point::Point(const Point& source, float* features)
+{
+	this->dimension = source.dimension;
+	this-> value = source.value;
+	this->features = features;
+	this->is_features_owned = false;
 	memcpy(this->features, source.features, source.dimension*sizeof(float));
 }
 
 Point::~Point()
 {
-	delete [] this->features;
+	if(this->is_features_owned)
+		delete [] this->features;
 }
 
 size_t Point::get_dimension()
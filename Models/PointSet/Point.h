@@ -25,12 +25,20 @@ class Point {
 		/**
 		 * Features data of the point.
 		 *
-		 * @note This is owned by the object.
+		 * @note This is owned by the object, unless
+		 * 	{@link #is_features_owned is_features_owned} is false.
 		 */
 		float* features;
 
 		/// Decision value of the point
 		bool value;
+
+		/**
+		 * Indicates whether features has been allocated by the object
+		 *
+		 * @see Point#Point(const Point&, float*)
+		 */
+		bool is_features_owned;
 	
 	public:
 		/**
@@ -85,10 +93,21 @@ class Point {
 		 */
 		Point(const Point& source);
 
+		/**
+		 * Copy a Point into storage provided by the caller
+		 *
+		 * This is used for laying out points and their features contiguously.
+		 *
+		 * @param source Point from which data will be copied
+		 * @param features Array of source.get_dimension() floats receiving the
+		 * 	features. No ownership is taken, it should outlive the point
+		 */
+		Point(const Point& source, float* features);
+
 		/**
 		 * Destructor of Point.
 		 *
-		 * Free memory of features.
+		 * Free memory of features, if owned.
 		 */
 		~Point();
 
@@ -12,11 +12,14 @@ PointSet::PointSet(std::multiset<Point*> points, size_t dimension, std::vector<F
 {
 	this->is_gini_calculated = false;
 	this->is_gain_calculated = false;
+	this->is_gain_in_progress = false;
 	this->is_positive_proportion_calculated = false;
+	this->use_subset_splits = false;
 	this->dimension = dimension;
 }
 PointSet::PointSet(const PointSet& source) : 
 		points(source.points),
+		tombstones(source.tombstones),
 		dimension(source.dimension),
 		features_types(source.features_types),
 		is_feature_relevent(source.is_feature_relevent)
@@ -24,9 +27,11 @@ PointSet::PointSet(const PointSet& source) :
 	this->is_positive_proportion_calculated = source.is_positive_proportion_calculated;
 	this->is_gini_calculated = source.is_gini_calculated;
 	this->is_gain_calculated = source.is_gain_calculated;
+	this->is_gain_in_progress = false;
 	this->positive_counter = source.positive_counter;
 	this->positive_proportion = source.positive_proportion;
 	this->gini = source.gini;
+	this->use_subset_splits = source.use_subset_splits;
 	if(source.is_gain_calculated)
 	{
 		this->best_under_counter = source.best_under_counter;
@@ -34,13 +39,17 @@ PointSet::PointSet(const PointSet& source) :
 		this->best_over_counter = source.best_over_counter;
 		this->best_over_positive_counter = source.best_over_positive_counter;
 		this->best_gain = source.best_gain;
+		this->second_best_gain = source.second_best_gain;
 		this->best_parameter = source.best_parameter;
 		this->best_threshold = source.best_threshold;
+		this->best_categories = source.best_categories;
 	}
 	
 }
 PointSet::PointSet(const PointSet& source, std::multiset<Point*> new_points):
 		points(new_points),
+		features_types(source.features_types),
+		is_feature_relevent(source.is_feature_relevent),
 		dimension(source.dimension),
 		positive_counter(source.positive_counter),
 		positive_proportion(source.positive_proportion),
@@ -52,11 +61,13 @@ PointSet::PointSet(const PointSet& source, std::multiset<Point*> new_points):
 		best_over_counter(source.best_over_counter),
 		best_over_positive_counter(source.best_over_positive_counter),
 		best_gain(source.best_gain),
+		second_best_gain(source.second_best_gain),
 		best_parameter(source.best_parameter),
 		best_threshold(source.best_threshold),
+		best_categories(source.best_categories),
+		use_subset_splits(source.use_subset_splits),
 		is_gain_calculated(source.is_gain_calculated),
-		features_types(source.features_types),
-		is_feature_relevent(source.is_feature_relevent)
+		is_gain_in_progress(false)
 {}
 
 PointSet& PointSet::operator=(const PointSet& source)
@@ -64,11 +75,13 @@ PointSet& PointSet::operator=(const PointSet& source)
 	this->is_positive_proportion_calculated = source.is_positive_proportion_calculated;
 	this->is_gini_calculated = source.is_gini_calculated;
 	this->is_gain_calculated = source.is_gain_calculated;
+	this->is_gain_in_progress = false;
 	this->positive_counter = source.positive_counter;
 	this->positive_proportion = source.positive_proportion;
 	this->gini = source.gini;
 	this->features_types = source.features_types;
 	this->is_feature_relevent = source.is_feature_relevent;
+	this->use_subset_splits = source.use_subset_splits;
 	if(source.is_gain_calculated)
 	{
 		this->best_under_counter = source.best_under_counter;
@@ -76,8 +89,10 @@ PointSet& PointSet::operator=(const PointSet& source)
 		this->best_over_counter = source.best_over_counter;
 		this->best_over_positive_counter = source.best_over_positive_counter;
 		this->best_gain = source.best_gain;
+		this->second_best_gain = source.second_best_gain;
 		this->best_parameter = source.best_parameter;
 		this->best_threshold = source.best_threshold;
+		this->best_categories = source.best_categories;
 	}
 	return *this;	
 }
@@ -85,16 +100,17 @@ PointSet& PointSet::operator=(const PointSet& source)
 PointSet::~PointSet()
 {}
 
-size_t PointSet::get_size() { return this->points.size();}
+size_t PointSet::get_size() { return this->points.size() - this->tombstones.size();}
 
 float PointSet::get_positive_proportion()
 {
 	if(!this->is_positive_proportion_calculated)
 	{
+		this->purge();
 		this->positive_counter  = 0;
 		for(auto it = this->points.begin(); it != this->points.end(); it++)
 			this->positive_counter += (*it)->get_value();
-		this->positive_proportion = (float)this->positive_counter / (float)this->points.size();
+		this->positive_proportion = (float)this->positive_counter / (float)this->get_size();
 		this-> is_positive_proportion_calculated = true;
 	}
 	return this->positive_proportion;
@@ -112,141 +128,214 @@ float PointSet::get_gini()
 
 unsigned int PointSet::get_training_error()
 {
-	unsigned int negative_counter = this->points.size() - this->positive_counter;
+	this->get_positive_proportion(); // To have positive_counter up to date
+	unsigned int negative_counter = this->get_size() - this->positive_counter;
 	return this->positive_counter > negative_counter ? negative_counter : positive_counter;
 }
 
-void PointSet::calculate_best_gain()
+void PointSet::start_best_gain()
 {
-	if(!this->is_gain_calculated)
+	this->purge();
+	if(this->points.empty())
+	{
+		this->best_under_counter = 0;
+		this->best_under_positive_counter = 0;
+		this->best_over_counter = 0;
+		this->best_over_positive_counter = 0;
+		this->best_gain = 0;
+		this->second_best_gain = NAN;
+		this->best_parameter = 0;
+		this->best_threshold = 0;
+		this->best_categories = 0;
+		this->is_gain_calculated = true;
+	}
+	else
+	{
+		this->get_positive_proportion(); // To have positive_counter up to date
+		this->gain_points.assign(this->points.begin(), this->points.end());
+		this->next_gain_dimension = 0;
+		this->best_gain = NAN;
+		this->second_best_gain = NAN;
+		this->best_threshold = NAN;
+		this->best_categories = 0;
+		this->best_parameter = 0;
+		this->is_gain_in_progress = true;
+	}
+}
+
+void PointSet::finish_best_gain()
+{
+	std::vector<Point*>().swap(this->gain_points);
+	std::vector<std::pair<float, bool>>().swap(this->gain_values);
+	this->is_gain_in_progress = false;
+	this->is_gain_calculated = true;
+}
+
+double PointSet::consider_split(size_t current_dim, float threshold, unsigned int under_counter, unsigned int under_positive_counter, unsigned int over_counter, unsigned int over_positive_counter, uint64_t categories)
+{
+	double fraction_under = (double)under_positive_counter/(double)under_counter;
+	double fraction_over = (double)over_positive_counter/(double)over_counter;
+	double current_gain = -((double)under_positive_counter*(1-fraction_under) + (double)over_positive_counter*(1-fraction_over));
+	// --- If best param/threshold
+	if(isnan(this->best_gain) || current_gain > this->best_gain)
+	{
+		this->second_best_gain = this->best_gain;
+		this->best_under_counter = under_counter;
+		this->best_under_positive_counter = under_positive_counter;
+		this->best_over_counter = over_counter;
+		this->best_over_positive_counter = over_positive_counter;
+		this->best_gain = current_gain;
+		this->best_parameter = current_dim;
+		this->best_threshold = threshold;
+		this->best_categories = categories;
+	} // --- If best param/threshold
+	else if(isnan(this->second_best_gain) || current_gain > this->second_best_gain)
+		this->second_best_gain = current_gain;
+	return current_gain;
+}
+
+bool PointSet::evaluate_subsets(size_t current_dim, const std::map<float, std::array<unsigned long, 2>>& nb_in_class)
+{
+	std::vector<std::pair<double, float>> sorted_classes; // Proportion of positive and class
+	for(auto class_it = nb_in_class.begin(); class_it != nb_in_class.end(); class_it++)
+	{
+		if(class_it->first < 0 || class_it->first >= MAX_SUBSET_CATEGORIES || class_it->first != floor(class_it->first))
+			return false;
+		sorted_classes.push_back(std::make_pair((double)class_it->second[1] / (double)class_it->second[0], class_it->first));
+	}
+	// For binary labels, the best subset split is between a prefix of the
+	// classes sorted by proportion of positive and the rest (Breiman)
+	std::sort(sorted_classes.begin(), sorted_classes.end());
+	uint64_t over_categories = 0;
+	unsigned int over_counter = 0;
+	unsigned int over_positive_counter = 0;
+	double feature_best_gain = NAN;
+	for(size_t i = 0; i + 1 < sorted_classes.size(); i++)
+	{
+		const std::array<unsigned long, 2>& class_counters = nb_in_class.at(sorted_classes[i].second);
+		over_categories |= (uint64_t)1 << (unsigned int)sorted_classes[i].second;
+		over_counter += class_counters[0];
+		over_positive_counter += class_counters[1];
+		double current_gain = this->consider_split(current_dim, NAN, this->get_size() - over_counter, this->positive_counter - over_positive_counter, over_counter, over_positive_counter, over_categories);
+		if(isnan(feature_best_gain) || current_gain > feature_best_gain)
+			feature_best_gain = current_gain;
+	}
+	// The subsets that are not prefixes are not evaluated, but may give the
+	// runner-up split. Their gain is bounded by the best one of the feature
+	if(sorted_classes.size() > 2 && !isnan(feature_best_gain) && (isnan(this->second_best_gain) || feature_best_gain > this->second_best_gain))
+		this->second_best_gain = feature_best_gain;
+	return true;
+}
+
+unsigned long PointSet::evaluate_feature(size_t current_dim)
+{
+	std::vector<Point*>& points_vector = this->gain_points;
+	unsigned int under_counter;
+	unsigned int under_positive_counter;
+	unsigned int over_counter;
+	unsigned int over_positive_counter;
+	float current_param_value;
+	// If the feature is real, we have to sort the point according to the feature and then splitting somewhere in this ordered sequence
+	if(this->features_types[current_dim] == FeatureType::REAL)
 	{
-		if(this->points.empty())
+		std::vector<std::pair<float, bool>>& values = this->gain_values;
+		values.clear();
+		for(auto it = points_vector.begin(); it != points_vector.end(); it++)
+			values.push_back(std::make_pair((*it)->get_feature(current_dim), (*it)->get_value()));
+		std::sort(values.begin(), values.end(), [](const std::pair<float, bool>& a, const std::pair<float, bool>& b) { return a.first < b.first; });
+		// We initialize with only one point under and all other points over the splitting threshold
+		under_counter = 1;
+		under_positive_counter = values[0].second;
+		over_counter = (unsigned int)this->get_size() - 1;
+		over_positive_counter = this->positive_counter - values[0].second;
+		// --- For points in vector
+		for(auto it = values.begin(); it != values.end();)
 		{
-			this->best_under_counter = 0;
-			this->best_under_positive_counter = 0;
-			this->best_over_counter = 0;
-			this->best_over_positive_counter = 0;
-			this->best_gain = 0;
-			this->best_parameter = 0;
-			this->best_threshold = 0;
-		}
-		else
+			current_param_value = it->first;
+
+			// At the end of the loop, "it" is on the first point for which the feature is not equal,
+			// but the counters don't take that last point into account yet
+			for(it++;  it != values.end() && it->first == current_param_value; it++)
+			{
+				under_counter++;
+				under_positive_counter += it->second;
+				over_counter--;
+				over_positive_counter -= it->second;
+			}
+			// --- If iterator not at end
+			if(it != values.end())
+			{
+				this->consider_split(current_dim, (current_param_value + it->first)/2, under_counter, under_positive_counter, over_counter, over_positive_counter);
+				under_counter++;
+				under_positive_counter += it->second;
+				over_counter--;
+				over_positive_counter -= it->second;
+			} // --- If iterator not at end
+		} // --- For points in vector
+		return points_vector.size();
+	}
+	else if(this->is_feature_relevent[current_dim])
+	{
+		std::map<float, std::array<unsigned long, 2>> nb_in_class; // First value in nb and second is nb of positive
+		// Populate map
+		for(auto it = points_vector.begin(); it != points_vector.end(); it++)
 		{
-			this->get_positive_proportion(); // To have positive_counter up to date
-			std::vector<Point*> points_vector(this->points.begin(), this->points.end());
-			std::vector<std::map<float, std::array<unsigned long, 2>>> nb_in_class(this->dimension, std::map<float, std::array<unsigned long, 2>>()); // First value in nb and second is nb of positive
-			
-			// Populate map
-			for(auto it = points_vector.begin(); it != points_vector.end(); it++)
+			auto it_nb_in_class = nb_in_class.find((*it)->get_feature(current_dim));
+			if(it_nb_in_class == nb_in_class.end())
+				nb_in_class[(*it)->get_feature(current_dim)] = {1, (*it)->get_value()};
+			else
 			{
-				for(size_t current_dim = 0; current_dim < this->dimension; current_dim++)
-				{
-					if(this->is_feature_relevent[current_dim] && this->features_types[current_dim] != FeatureType::REAL)
-					{
-						auto it_nb_in_class = nb_in_class[current_dim].find((*it)->get_feature(current_dim));
-						if(it_nb_in_class == nb_in_class[current_dim].end())
-						{
-							nb_in_class[current_dim][(*it)->get_feature(current_dim)] = {1, (*it)->get_value()};
-						}
-						else
-						{
-							it_nb_in_class->second[0]++;
-							it_nb_in_class->second[1]+= (*it)->get_value();
-						}
-					}
-				}
+				it_nb_in_class->second[0]++;
+				it_nb_in_class->second[1]+= (*it)->get_value();
 			}
+		}
+		if(this->use_subset_splits && this->features_types[current_dim] == FeatureType::CLASSIFIED && this->evaluate_subsets(current_dim, nb_in_class))
+			return points_vector.size();
+		for(auto class_it = nb_in_class.begin(); class_it != nb_in_class.end(); class_it++)
+		{
+			under_counter = this->get_size() - class_it->second[0];
+			under_positive_counter = this->positive_counter - class_it->second[1];
+			over_counter = class_it->second[0];
+			over_positive_counter = class_it->second[1];
+			this->consider_split(current_dim, class_it->first, under_counter, under_positive_counter, over_counter, over_positive_counter);
+		}
+		return points_vector.size();
+	}
+	return 0;
+}
 
-			unsigned int under_counter;
-			unsigned int under_positive_counter;
-			unsigned int over_counter;
-			unsigned int over_positive_counter;
-			float current_param_value;
-			double fraction_under, fraction_over;
-			double current_gain;
-			this->best_gain = NAN;
-			this->best_threshold = NAN;
-			this->best_parameter = 0;
+void PointSet::calculate_best_gain()
+{
+	if(!this->is_gain_calculated)
+	{
+		if(!this->is_gain_in_progress)
+			this->start_best_gain();
+		if(this->is_gain_in_progress)
+		{
 			// --- For all dimensions
-			for(size_t current_dim = 0; current_dim < this->dimension; current_dim++)
-			{
-				// If the feature is real, we have to sort the point according to the feature and then splitting somewhere in this ordered sequence
-				if(this->features_types[current_dim] == FeatureType::REAL)
-				{
-					std::sort(points_vector.begin(), points_vector.end(), [current_dim](Point* const &a, Point* const &b) { return (*a)[current_dim] < (*b)[current_dim]; });
-					// We initialize with only one point under and all other points over the splitting threshold
-					under_counter = 1;
-					under_positive_counter = points_vector[0]->get_value();
-					over_counter = (unsigned int)this->points.size() - 1;
-					over_positive_counter = this->positive_counter - points_vector[0]->get_value();
-					// --- For points in vector
-					for(auto it = points_vector.begin(); it != points_vector.end();)
-					{
-						current_param_value = (*it)->get_feature(current_dim);
-
-						// At the end of the loop, "it" is on the first point for which the feature is not equal,
-						// but the counters don't take that last point into account yet
-						for(it++;  it != points_vector.end() && (*it)->get_feature(current_dim) == current_param_value; it++)
-						{
-							under_counter++;
-							under_positive_counter += (*it)->get_value();
-							over_counter--;
-							over_positive_counter -= (*it)->get_value();
-						}
-						// --- If iterator not at end
-						if(it != points_vector.end())
-						{
-							fraction_under = (double)under_positive_counter/(double)under_counter;
-							fraction_over = (double)over_positive_counter/(double)over_counter;
-							current_gain = -((double)under_positive_counter*(1-fraction_under) + (double)over_positive_counter*(1-fraction_over));
-							// --- If best param/threshold
-							if(isnan(this->best_gain) || current_gain > this->best_gain)
-							{
-								this->best_under_counter = under_counter;
-								this->best_under_positive_counter = under_positive_counter;
-								this->best_over_counter = over_counter;
-								this->best_over_positive_counter = over_positive_counter;
-								this->best_gain = current_gain;
-								this->best_parameter = current_dim;
-								this->best_threshold = (current_param_value + (*it)->get_feature(current_dim))/2;
-							} // --- If best param/threshold
-							under_counter++;
-							under_positive_counter += (*it)->get_value();
-							over_counter--;
-							over_positive_counter -= (*it)->get_value();
-						} // --- If iterator not at end
-					} // --- For points in vector
-				}
-				else if(this->is_feature_relevent[current_dim])
-				{
-					for(auto class_it = nb_in_class[current_dim].begin(); class_it != nb_in_class[current_dim].end(); class_it++)
-					{
-						under_counter = this->get_size() - class_it->second[0];
-						under_positive_counter = this->positive_counter - class_it->second[1];
-						over_counter = class_it->second[0];
-						over_positive_counter = class_it->second[1];
-						fraction_under = (double)under_positive_counter/(double)under_counter;
-						fraction_over = (double)over_positive_counter/(double)over_counter;
-						current_gain = -((double)under_positive_counter*(1-fraction_under) + (double)over_positive_counter*(1-fraction_over));
-						// --- If best param/theshold
-						if(isnan(this->best_gain) || current_gain > this->best_gain)
-						{
-							this->best_under_counter = under_counter;
-							this->best_under_positive_counter = under_positive_counter;
-							this->best_over_counter = over_counter;
-							this->best_over_positive_counter = over_positive_counter;
-							this->best_gain = current_gain;
-							this->best_parameter = current_dim;
-							this->best_threshold = class_it->first;
-						} // --- If best param/threshold
-					}
-				}
-			} // --- For all dimensions
-		} // Else (of "if empty set of points")
-		this->is_gain_calculated = true;
+			while(this->next_gain_dimension < this->dimension)
+				this->evaluate_feature(this->next_gain_dimension++);
+			this->finish_best_gain();
+		}
 	} // If not calculated yet
 }
 
+bool PointSet::advance_best_gain(unsigned long& budget)
+{
+	if(!this->is_gain_calculated)
+	{
+		if(!this->is_gain_in_progress)
+			this->start_best_gain();
+		while(this->is_gain_in_progress && budget > 0)
+		{
+			budget -= std::min(budget, this->evaluate_feature(this->next_gain_dimension++));
+			if(this->next_gain_dimension == this->dimension)
+				this->finish_best_gain();
+		}
+	}
+	return this->is_gain_calculated;
+}
+
 size_t PointSet::get_best_index()
 {
 	this->calculate_best_gain();
@@ -256,7 +345,13 @@ size_t PointSet::get_best_index()
 double PointSet::get_best_gain()
 {
 	this->calculate_best_gain();
-	return this->gini + (float)2/(float)this->points.size()*this->best_gain;
+	return this->gini + (float)2/(float)this->get_size()*this->best_gain;
+}
+
+double PointSet::get_second_best_gain()
+{
+	this->calculate_best_gain();
+	return this->gini + (float)2/(float)this->get_size()*this->second_best_gain;
 }
 
 float PointSet::get_best_threshold()
@@ -265,16 +360,33 @@ float PointSet::get_best_threshold()
 	return this->best_threshold;
 }
 
+uint64_t PointSet::get_best_categories()
+{
+	this->calculate_best_gain();
+	return this->best_categories;
+}
+
+void PointSet::set_use_subset_splits(bool use_subset_splits)
+{
+	if(this->use_subset_splits != use_subset_splits)
+	{
+		this->use_subset_splits = use_subset_splits;
+		this->is_gain_calculated = false;
+		this->is_gain_in_progress = false;
+	}
+}
+
 void PointSet::add_point(Point* new_point)
 {
 	this->points.insert(new_point);
 	if(this->is_positive_proportion_calculated)
 	{
 		this->positive_counter += new_point->get_value();
-		this->positive_proportion = (float)this->positive_counter / (float)this->points.size();
+		this->positive_proportion = (float)this->positive_counter / (float)this->get_size();
 		this->is_gini_calculated = false;
 	}
 	this->is_gain_calculated = false;
+	this->is_gain_in_progress = false;
 }
 
 void PointSet::delete_point(Point* old_point)
@@ -284,18 +396,67 @@ void PointSet::delete_point(Point* old_point)
 	if(this->is_positive_proportion_calculated)
 	{
 		this->positive_counter -= old_point->get_value();
-		this->positive_proportion = (float)this->positive_counter / (float)this->points.size();
+		this->positive_proportion = (float)this->positive_counter / (float)this->get_size();
 		this->is_gini_calculated = false;
 	}
 	this->is_gain_calculated = false;
+	this->is_gain_in_progress = false;
 }
 
+void PointSet::mark_deleted(Point* old_point)
+{
+	this->tombstones.push_back(old_point);
+	if(this->is_positive_proportion_calculated)
+	{
+		this->positive_counter -= old_point->get_value();
+		this->positive_proportion = (float)this->positive_counter / (float)this->get_size();
+		this->is_gini_calculated = false;
+	}
+	this->is_gain_calculated = false;
+	this->is_gain_in_progress = false;
+}
+
+void PointSet::purge()
+{
+	for(auto it = this->tombstones.begin(); it != this->tombstones.end(); it++)
+	{
+		auto it_point = this->points.find(*it);
+		if(it_point == this->points.end())
+			throw std::runtime_error("Error : Point not found (should not append, implementation error)");
+		this->points.erase(it_point);
+	}
+	std::vector<Point*>().swap(this->tombstones);
+}
 
 FeatureType PointSet::get_feature_type(size_t feature)
 {
 	return this->features_types[feature];
 }
 
+void PointSet::append_points(std::vector<Point*>& to_fill)
+{
+	this->purge();
+	to_fill.insert(to_fill.end(), this->points.begin(), this->points.end());
+}
+
+void PointSet::relocate(const std::unordered_map<Point*, Point*>& relocated)
+{
+	this->purge();
+	std::vector<Point*> new_points;
+	new_points.reserve(this->points.size());
+	for(auto it = this->points.begin(); it != this->points.end(); it++)
+	{
+		auto copy = relocated.find(*it);
+		new_points.push_back(copy == relocated.end() ? *it : copy->second);
+	}
+	// Inserting sorted points is linear
+	std::sort(new_points.begin(), new_points.end());
+	this->points = std::multiset<Point*>(new_points.begin(), new_points.end());
+	std::vector<Point*>().swap(this->gain_points);
+	std::vector<std::pair<float, bool>>().swap(this->gain_values);
+	this->is_gain_in_progress = false;
+}
+
 std::array<PointSet*, 2> PointSet::split_at_best()
 {
 	auto points_multisets = this->split_at_best_multiset();
@@ -308,7 +469,9 @@ std::array<PointSet*, 2> PointSet::split_at_best()
 	}
 	else if(this->features_types[this->best_parameter] == FeatureType::CLASSIFIED)
 	{
-		is_feature_relevent_over[this->best_parameter] = false;
+		// After a subset split, several categories may remain in the right leg
+		if(this->best_categories == 0 || (this->best_categories & (this->best_categories - 1)) == 0)
+			is_feature_relevent_over[this->best_parameter] = false;
 	}
 	std::array<PointSet*, 2> to_return = {
 		new PointSet(points_multisets[0], this->dimension, this->features_types, is_feature_relevent_under), 
@@ -321,6 +484,8 @@ std::array<PointSet*, 2> PointSet::split_at_best()
 		(float)this->best_over_positive_counter/(float)this->best_over_counter;
 	to_return[1]->positive_counter = this->best_over_positive_counter;
 	to_return[1]->is_positive_proportion_calculated = true;
+	to_return[0]->use_subset_splits = this->use_subset_splits;
+	to_return[1]->use_subset_splits = this->use_subset_splits;
 	
 	return to_return;
 }
@@ -329,6 +494,7 @@ std::array<std::multiset<Point*>, 2> PointSet::split_at_best_multiset()
 {
 	std::array<std::multiset<Point*>, 2>  to_return;
 	this->calculate_best_gain();
+	this->purge();
 	auto it_under = to_return[0].begin();
 	auto it_over = to_return[1].begin();
 	if(this->features_types[this->best_parameter] == FeatureType::REAL)
@@ -339,6 +505,14 @@ std::array<std::multiset<Point*>, 2> PointSet::split_at_best_multiset()
 			else
 				it_over = to_return[1].insert(it_over, *it);
 	}
+	else if(this->best_categories != 0)
+	{
+		for(auto it = this->points.begin(); it != this->points.end(); it++)
+			if(!PointSet::is_in_categories(this->best_categories, (*it)->get_feature(this->best_parameter)))
+				it_under = to_return[0].insert(it_under, *it);
+			else
+				it_over = to_return[1].insert(it_over, *it);
+	}
 	else
 	{
 		for(auto it = this->points.begin(); it != this->points.end(); it++)
@@ -8,6 +8,9 @@
 #include <set>
 #include <array>
 #include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
 #include "Point.h"
 
 /// Possible types of features.
@@ -36,6 +39,17 @@ class PointSet {
 		 */
 		std::multiset<Point*> points;
 
+		/**
+		 * Points deleted from the PointSet but still in {@link #points points}
+		 *
+		 * Those are removed from points by PointSet#purge. The counters of the
+		 * PointSet already take their deletion into account.
+		 *
+		 * @note Those pointers are only compared, never dereferenced, hence the
+		 * 	points may have been freed
+		 */
+		std::vector<Point*> tombstones;
+
 		/**
 		 * Types of each feature of the dataset points.
 		 *
@@ -135,10 +149,42 @@ class PointSet {
 		 */
 		double best_gain;
 
+		/**
+		 * Proxy of gain for the runner-up feature/threshold.
+		 *
+		 * Same proxy as {@link #best_gain best_gain}, for the best split
+		 * other than the chosen one. NAN when there is no other candidate.
+		 */
+		double second_best_gain;
+
 		/// Feature along which splitting maximise gini gain.
 		size_t best_parameter;
 		/// Threashold in best feature along which splitting maximise gini gain
 		float best_threshold;
+
+		/**
+		 * Categories going in right leg for the best split, as a bitmask
+		 *
+		 * Bit i is set if the points whose best feature equals i go in the
+		 * right leg. This is 0 unless the best split is a subset split.
+		 *
+		 * @see PointSet#use_subset_splits
+		 */
+		uint64_t best_categories;
+
+		/**
+		 * Indicates whether classified features are split by subsets
+		 *
+		 * If false, a classified feature is split between one category and
+		 * all the others. If true, the categories are sorted by proportion of
+		 * positive points, and the split between a prefix of this order and
+		 * the rest that maximises the gain is chosen, which is the best split
+		 * among all the subsets of categories. This requires the categories to
+		 * be integers between 0 and {@link #MAX_SUBSET_CATEGORIES
+		 * MAX_SUBSET_CATEGORIES} - 1, otherwise the feature is split between
+		 * one category and the others.
+		 */
+		bool use_subset_splits;
 		/**
 		 * Keep track of calling of calculate_best_gain().
 		 *
@@ -148,10 +194,88 @@ class PointSet {
 		 */
 		bool is_gain_calculated;
 
+		/**
+		 * Keep track of a search of best gain made in several steps.
+		 *
+		 * True when the search has been started by advance_best_gain() but not
+		 * all features have been evaluated yet. Any update of the PointSet
+		 * cancels the search.
+		 */
+		bool is_gain_in_progress;
+
+		/// Index of the next feature to evaluate while the search is in progress
+		size_t next_gain_dimension;
+
+		/**
+		 * Points being evaluated while the search of best gain is in progress.
+		 *
+		 * It is emptied once all features have been evaluated.
+		 */
+		std::vector<Point*> gain_points;
+
+		/**
+		 * Value of the feature being evaluated and decision value of each of
+		 * {@link #gain_points gain_points}
+		 *
+		 * Real features are evaluated by sorting this vector, which is filled
+		 * by going through the points once, so that the points are not read
+		 * in the sorted order.
+		 */
+		std::vector<std::pair<float, bool>> gain_values;
+
 		/// Update data related to best gini gain.
 		void calculate_best_gain();
+
+		/// Initialise the search of best gain, before evaluating features.
+		void start_best_gain();
+
+		/// Conclude the search of best gain, once all features are evaluated.
+		void finish_best_gain();
+
+		/**
+		 * Evaluate all the splits along a feature
+		 *
+		 * Update the best and runner-up split data with all the thresholds
+		 * available along the feature.
+		 *
+		 * @param current_dim Index of the feature to evaluate
+		 * @return The number of point-operations made, 0 if the feature is
+		 * 	not relevant
+		 */
+		unsigned long evaluate_feature(size_t current_dim);
+
+		/**
+		 * Compare a split to the best ones found so far
+		 *
+		 * @param current_dim Feature of the split
+		 * @param threshold Threshold of the split
+		 * @param categories For a subset split, bitmask of the categories of
+		 * 	the right leg, see {@link #best_categories best_categories}
+		 * @param under_counter Number of points in the left leg
+		 * @param under_positive_counter Number of positive points in the left
+		 * 	leg
+		 * @param over_counter Number of points in the right leg
+		 * @param over_positive_counter Number of positive points in the right
+		 * 	leg
+		 * @return The proxy of gain of the split
+		 */
+		double consider_split(size_t current_dim, float threshold, unsigned int under_counter, unsigned int under_positive_counter, unsigned int over_counter, unsigned int over_positive_counter, uint64_t categories = 0);
+
+		/**
+		 * Evaluate the splits of a classified feature by subsets
+		 *
+		 * @param current_dim Index of the feature to evaluate
+		 * @param nb_in_class Number of points and of positive points for each
+		 * 	category of the feature
+		 * @return false if the categories do not allow a subset split, in
+		 * 	which case nothing has been evaluated
+		 */
+		bool evaluate_subsets(size_t current_dim, const std::map<float, std::array<unsigned long, 2>>& nb_in_class);
 	
 	public:
+		/// Number of categories that can be handled by subset splits
+		static const unsigned int MAX_SUBSET_CATEGORIES = 64;
+
 		/**
 		 * Main constructor of PointSet
 		 * 
@@ -261,6 +385,31 @@ class PointSet {
 		 */
 		double get_best_gain();
 
+		/**
+		 * Get the gain expected for cutting along the runner-up split
+		 *
+		 * This is the exact gain of the best feature/threshold other than the
+		 * one given by {@link #get_best_index() get_best_index} and
+		 * {@link #get_best_threshold() get_best_threshold}.
+		 *
+		 * @return The runner-up gain, or NAN if there is no other candidate
+		 */
+		double get_second_best_gain();
+
+		/**
+		 * Advance the search of best feature/threshold within a budget
+		 *
+		 * Evaluate features one by one until the search is complete or
+		 * @p budget point-operations have been spent. A feature is always
+		 * evaluated entirely, so the last one may exceed the budget.
+		 *
+		 * @param budget In/out argument, the number of point-operations
+		 * 	allowed. It is decreased by the number of operations made
+		 * @return true if the search is complete
+		 * @note Any update of the PointSet restarts the search
+		 */
+		bool advance_best_gain(unsigned long& budget);
+
 		/// Get index of feature along which splitting maximizes gain
 		size_t get_best_index();
 		
@@ -275,6 +424,39 @@ class PointSet {
 		 */ 
 		float get_best_threshold();
 
+		/**
+		 * Get the categories going in right leg for the best split
+		 *
+		 * @return A bitmask of the categories, see PointSet#is_in_categories,
+		 * 	or 0 if the best split is not a subset split, in which case
+		 * 	{@link #get_best_threshold() get_best_threshold} applies
+		 */
+		uint64_t get_best_categories();
+
+		/**
+		 * Indicates whether a category belongs in a bitmask of categories
+		 *
+		 * @param categories Bitmask of categories, as given by
+		 * 	{@link #get_best_categories() get_best_categories}
+		 * @param value Value of the classified feature
+		 */
+		static bool is_in_categories(uint64_t categories, float value)
+		{
+			return value >= 0 && value < MAX_SUBSET_CATEGORIES && ((categories >> (unsigned int)value) & 1);
+		};
+
+		/**
+		 * Enable or disable subset splits of classified features
+		 *
+		 * This applies to the next searches of best split, and is inherited by
+		 * the pointsets made by splitting this one.
+		 *
+		 * @param use_subset_splits True to split classified features by
+		 * 	subsets of categories
+		 * @see PointSet#use_subset_splits
+		 */
+		void set_use_subset_splits(bool use_subset_splits);
+
 		/**
 		 * Add point to the PointSet
 		 * 
@@ -300,6 +482,29 @@ class PointSet {
 		 */
 		void delete_point(Point* old_point);
 
+		/**
+		 * Remove point from the PointSet without searching for it
+		 *
+		 * The counters are updated at once, but the point is only removed
+		 * from the underlying multiset by the next PointSet#purge, which is
+		 * made before any computation going through the points.
+		 *
+		 * @param old_point Point to remove, which should belong in the
+		 * 	PointSet. It is never dereferenced after this call
+		 */
+		void mark_deleted(Point* old_point);
+
+		/**
+		 * Remove the points marked as deleted from the underlying multiset
+		 *
+		 * @throw std::runtime_error When a point marked as deleted does not
+		 * 	belong in the pointset
+		 */
+		void purge();
+
+		/// Get the number of points marked as deleted and not purged yet
+		size_t get_nb_tombstones() const {return this->tombstones.size();};
+
 		/**
 		 * Get the type of a feature
 		 * 
@@ -309,6 +514,27 @@ class PointSet {
 		 */
 		FeatureType get_feature_type(size_t feature);
 
+		/**
+		 * Append the points of the PointSet to a vector
+		 *
+		 * The points marked as deleted are purged first. The points are
+		 * appended in the order in which the PointSet goes through them,
+		 * which is the order of their addresses.
+		 *
+		 * @param to_fill The vector to which the points are appended
+		 */
+		void append_points(std::vector<Point*>& to_fill);
+
+		/**
+		 * Replace the points by copies of them stored elsewhere
+		 *
+		 * The statistics of the PointSet are kept, as the copies hold the
+		 * same data. A search of best gain in progress is restarted. The
+		 * points that have no copy are kept.
+		 *
+		 * @param relocated The copy of each point, by point
+		 */
+		void relocate(const std::unordered_map<Point*, Point*>& relocated);
 
 		/**
 		 * Create two PointSet by splitting to get best gain
@@ -0,0 +1,50 @@
+#include "CompiledTree.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <dlfcn.h>
+#include <unistd.h>
+
+CompiledTree::CompiledTree(Tree& tree, const std::string& directory, const std::string& compiler) :
+	library(NULL),
+	function(NULL)
+{
+	std::string source_path = directory + "/dynamic_tree_XXXXXX";
+	int source_descriptor = mkstemp(&source_path[0]);
+	if(source_descriptor == -1)
+		throw std::runtime_error("Error : could not create a file in " + directory);
+	close(source_descriptor);
+	std::string library_path = source_path + ".so";
+
+	std::ofstream source(source_path);
+	tree.export_cpp(source);
+	source.close();
+	// The source has no extension, hence its language is given
+	std::string command = compiler + " -O2 -shared -fPIC -x c++ " + source_path + " -o " + library_path;
+	int status = std::system(command.c_str());
+	std::remove(source_path.c_str());
+	if(status != 0)
+	{
+		std::remove(library_path.c_str());
+		throw std::runtime_error("Error : compilation of the tree failed : " + command);
+	}
+
+	// The shared object stays mapped once its file is removed
+	this->library = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	std::remove(library_path.c_str());
+	if(this->library == NULL)
+		throw std::runtime_error(std::string("Error : could not load the compiled tree : ") + dlerror());
+	this->function = (bool (*)(const float*))dlsym(this->library, "tree_decision");
+	if(this->function == NULL)
+	{
+		dlclose(this->library);
+		throw std::runtime_error("Error : no decision function in the compiled tree");
+	}
+}
+
+CompiledTree::~CompiledTree()
+{
+	dlclose(this->library);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file CompiledTree.h
+ * Definition of class CompiledTree
+ */
+#ifndef COMPILEDTREE_H_INCLUDED
+#define COMPILEDTREE_H_INCLUDED
+
+#include <string>
+#include "Tree.h"
+
+/**
+ * A snapshot of the decisions of a Tree, compiled to machine code
+ *
+ * The tree is exported by Tree#export_cpp, compiled into a shared object by
+ * the system compiler and loaded with dlopen. Decisions are then a call to
+ * a function made only of branches, without reading the tree.
+ *
+ * The snapshot is not updated with the tree, and is meant for scorers
+ * refreshing their model periodically.
+ */
+class CompiledTree {
+	private:
+		/// Handle of the shared object, as given by dlopen
+		void* library;
+
+		/// The decision function loaded from the shared object
+		bool (*function)(const float*);
+
+	public:
+		/**
+		 * Compile a snapshot of a tree and load it
+		 *
+		 * @param tree The tree to compile. It is not referenced afterwards
+		 * @param directory Directory for the temporary source and shared
+		 * 	object, which are removed once loaded
+		 * @param compiler Command of the C++ compiler
+		 * @throw std::runtime_error When the compilation or the loading failed
+		 */
+		CompiledTree(Tree& tree, const std::string& directory = "/tmp", const std::string& compiler = "c++");
+
+		/// Copying would unload the shared object twice
+		CompiledTree(const CompiledTree&) = delete;
+
+		/// Copying would unload the shared object twice
+		CompiledTree& operator=(const CompiledTree&) = delete;
+
+		/**
+		 * Destructor of CompiledTree
+		 *
+		 * Unload the shared object
+		 */
+		~CompiledTree();
+
+		/**
+		 * The decision associated with the given features
+		 *
+		 * @param features The features of the point to evaluate. The ownership
+		 * 	of this array is not taken by the method
+		 */
+		bool decision(const float* features) {return this->function(features);};
+};
+#endif // COMPILEDTREE_H_INCLUDED
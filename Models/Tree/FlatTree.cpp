@@ -0,0 +1,264 @@
+#include "FlatTree.h"
+
+#include <algorithm>
+
+#ifdef __GNUC__
+#define FLAT_TREE_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define FLAT_TREE_PREFETCH(address)
+#endif
+
+template<size_t DIMENSION>
+void FlatTree::set_kernels()
+{
+	if(this->is_all_real)
+	{
+		this->decision_kernel_for_schema = &FlatTree::decision_kernel<true>;
+		this->row_kernel_for_schema = &FlatTree::decision_batch_kernel<DIMENSION, true, false>;
+		this->column_kernel_for_schema = &FlatTree::decision_batch_kernel<DIMENSION, true, true>;
+	}
+	else
+	{
+		this->decision_kernel_for_schema = &FlatTree::decision_kernel<false>;
+		this->row_kernel_for_schema = &FlatTree::decision_batch_kernel<DIMENSION, false, false>;
+		this->column_kernel_for_schema = &FlatTree::decision_batch_kernel<DIMENSION, false, true>;
+	}
+}
+
+// Dimensions above MAX_STATIC_DIMENSION, or 0, are only known at run time
+template<>
+void FlatTree::pick_kernels<0>()
+{
+	this->set_kernels<0>();
+}
+
+template<size_t DIMENSION>
+void FlatTree::pick_kernels()
+{
+	if(this->dimension == DIMENSION)
+		this->set_kernels<DIMENSION>();
+	else
+		this->pick_kernels<DIMENSION - 1>();
+}
+
+FlatTree::FlatTree(const std::vector<FeatureType>& features_types) :
+	dimension(features_types.size()),
+	is_all_real(std::all_of(features_types.begin(), features_types.end(), [](FeatureType type) {return type == FeatureType::REAL;})),
+	nb_nodes_at_layout(0),
+	structure_version(0)
+{
+	static_assert(sizeof(node) == 16, "A node should fit in 16 bytes");
+	this->pick_kernels<MAX_STATIC_DIMENSION>();
+}
+
+bool FlatTree::refresh(Vertex* root)
+{
+	if(!this->nodes.empty() && !root->is_flat_stale)
+		return false;
+	// The nodes of the replaced subtrees, and the entries they referenced,
+	// are only dropped by a full layout
+	bool is_full_layout = this->nodes.empty() || this->nodes.size() > 2 * this->nb_nodes_at_layout
+		|| this->deferred.size() > this->nodes.size() || this->categories.size() > this->nodes.size();
+	if(is_full_layout)
+	{
+		this->nodes.assign(1, node());
+		this->categories.clear();
+		this->deferred.clear();
+		root->flat_index = 0;
+		this->structure_version++;
+	}
+	std::deque<Vertex*> to_write{root};
+	while(!to_write.empty())
+	{
+		Vertex* vertex = to_write.front();
+		to_write.pop_front();
+		this->write_node(vertex, to_write);
+	}
+	if(is_full_layout)
+		this->nb_nodes_at_layout = this->nodes.size();
+	return true;
+}
+
+void FlatTree::write_node(Vertex* vertex, std::deque<Vertex*>& to_write)
+{
+	vertex->is_flat_stale = false;
+	const node previous = this->nodes[vertex->flat_index];
+	const uint64_t previous_categories = previous.kind == SUBSET_SPLIT ? this->categories[previous.categories_index] : 0;
+	node current = node();
+	// Same order of checks as Vertex#decision
+	if(vertex->is_dirty || !vertex->buffer.empty())
+	{
+		current.kind = DEFERRED;
+		if(previous.kind == DEFERRED && this->deferred[previous.child] == vertex)
+			current.child = previous.child;
+		else
+		{
+			current.child = this->deferred.size();
+			this->deferred.push_back(vertex);
+		}
+	}
+	else if(vertex->config->use_pruning && vertex->is_uniform)
+		current.kind = vertex->uniform_decision ? LEAF_TRUE : LEAF_FALSE;
+	else if(vertex->is_leaf)
+		current.kind = vertex->pointset->get_positive_proportion() >= 0.5 ? LEAF_TRUE : LEAF_FALSE;
+	else
+	{
+		current.feature = vertex->split_parameter;
+		if(vertex->pointset->get_feature_type(vertex->split_parameter) == FeatureType::REAL)
+		{
+			current.kind = REAL_SPLIT;
+			current.threshold = vertex->split_threshold;
+		}
+		else if(vertex->split_categories != 0)
+		{
+			current.kind = SUBSET_SPLIT;
+			if(previous.kind == SUBSET_SPLIT)
+				current.categories_index = previous.categories_index;
+			else
+			{
+				current.categories_index = this->categories.size();
+				this->categories.push_back(0);
+			}
+			this->categories[current.categories_index] = vertex->split_categories;
+		}
+		else
+		{
+			current.kind = EQUALITY_SPLIT;
+			current.threshold = vertex->split_threshold;
+		}
+
+		if(FlatTree::is_split(previous) && vertex->under_child->flat_index == previous.child && vertex->over_child->flat_index == previous.child + 1)
+			current.child = previous.child;
+		else
+		{
+			// New children, or children that were not in the array
+			current.child = this->nodes.size();
+			this->nodes.resize(this->nodes.size() + 2);
+			vertex->under_child->flat_index = current.child;
+			vertex->over_child->flat_index = current.child + 1;
+			vertex->under_child->is_flat_stale = true;
+			vertex->over_child->is_flat_stale = true;
+		}
+		if(vertex->under_child->is_flat_stale)
+			to_write.push_back(vertex->under_child);
+		if(vertex->over_child->is_flat_stale)
+			to_write.push_back(vertex->over_child);
+	}
+	if((FlatTree::is_split(previous) || FlatTree::is_split(current)) && (previous.kind != current.kind
+		|| previous.feature != current.feature || previous.child != current.child
+		|| (current.kind == SUBSET_SPLIT ? this->categories[current.categories_index] != previous_categories : previous.threshold != current.threshold)))
+		this->structure_version++;
+	this->nodes[vertex->flat_index] = current;
+}
+
+bool FlatTree::is_split(const node& to_check)
+{
+	return to_check.kind == REAL_SPLIT || to_check.kind == EQUALITY_SPLIT || to_check.kind == SUBSET_SPLIT;
+}
+
+bool FlatTree::decision(const float* features) const
+{
+	return (this->*decision_kernel_for_schema)(features);
+}
+
+template<bool IS_ALL_REAL>
+bool FlatTree::decision_kernel(const float* features) const
+{
+	const node* nodes = this->nodes.data();
+	uint32_t index = 0;
+	while(true)
+	{
+		const node& current = nodes[index];
+		// Written as in Vertex#get_child_for, so that NaN goes right
+		if(current.kind == REAL_SPLIT)
+			index = current.child + !(features[current.feature] <= current.threshold);
+		else if(!IS_ALL_REAL && current.kind == EQUALITY_SPLIT)
+			index = current.child + (features[current.feature] == current.threshold);
+		else if(!IS_ALL_REAL && current.kind == SUBSET_SPLIT)
+			index = current.child + PointSet::is_in_categories(this->categories[current.categories_index], features[current.feature]);
+		else if(current.kind == DEFERRED)
+			return this->deferred[current.child]->decision(features);
+		else
+			return current.kind == LEAF_TRUE;
+	}
+}
+
+void FlatTree::decision_batch(const float* features, size_t nb_points, bool is_column_major, bool* decisions) const
+{
+	if(is_column_major)
+		(this->*column_kernel_for_schema)(features, nb_points, decisions);
+	else
+		(this->*row_kernel_for_schema)(features, nb_points, decisions);
+}
+
+template<size_t DIMENSION, bool IS_ALL_REAL, bool IS_COLUMN_MAJOR>
+void FlatTree::decision_batch_kernel(const float* features, size_t nb_points, bool* decisions) const
+{
+	const node* nodes = this->nodes.data();
+	const size_t dimension = DIMENSION == 0 ? this->dimension : DIMENSION;
+	const size_t point_stride = IS_COLUMN_MAJOR ? 1 : dimension;
+	const size_t feature_stride = IS_COLUMN_MAJOR ? nb_points : 1;
+	uint32_t indexes[BATCH_BLOCK_SIZE];
+	size_t active[BATCH_BLOCK_SIZE];
+	for(size_t block_start = 0; block_start < nb_points; block_start += BATCH_BLOCK_SIZE)
+	{
+		size_t nb_active = std::min((size_t)BATCH_BLOCK_SIZE, nb_points - block_start);
+		for(size_t i = 0; i < nb_active; i++)
+		{
+			indexes[i] = 0;
+			active[i] = block_start + i;
+		}
+		while(nb_active > 0)
+		{
+			// The nodes have been prefetched by the previous step
+			for(size_t i = 0; i < nb_active; i++)
+				FLAT_TREE_PREFETCH(features + active[i] * point_stride + nodes[indexes[i]].feature * feature_stride);
+			size_t i = 0;
+			while(i < nb_active)
+			{
+				const node& current = nodes[indexes[i]];
+				const float* point = features + active[i] * point_stride;
+				const float value = point[current.feature * feature_stride];
+				bool is_done = true;
+				if(current.kind == REAL_SPLIT)
+				{
+					indexes[i] = current.child + !(value <= current.threshold);
+					is_done = false;
+				}
+				else if(!IS_ALL_REAL && current.kind == EQUALITY_SPLIT)
+				{
+					indexes[i] = current.child + (value == current.threshold);
+					is_done = false;
+				}
+				else if(!IS_ALL_REAL && current.kind == SUBSET_SPLIT)
+				{
+					indexes[i] = current.child + PointSet::is_in_categories(this->categories[current.categories_index], value);
+					is_done = false;
+				}
+				else if(current.kind == DEFERRED && IS_COLUMN_MAJOR)
+				{
+					std::vector<float> gathered(dimension);
+					for(size_t feature = 0; feature < dimension; feature++)
+						gathered[feature] = point[feature * feature_stride];
+					decisions[active[i]] = this->deferred[current.child]->decision(gathered.data());
+				}
+				else if(current.kind == DEFERRED)
+					decisions[active[i]] = this->deferred[current.child]->decision(point);
+				else
+					decisions[active[i]] = current.kind == LEAF_TRUE;
+				if(is_done)
+				{
+					// The last active point takes the place of this one
+					nb_active--;
+					indexes[i] = indexes[nb_active];
+					active[i] = active[nb_active];
+				}
+				else
+				{
+					FLAT_TREE_PREFETCH(nodes + indexes[i]);
+					i++;
+				}
+			}
+		}
+	}
+}
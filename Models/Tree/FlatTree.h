@@ -0,0 +1,243 @@
+/**
+ * @file FlatTree.h
+ * Definition of class FlatTree
+ */
+#ifndef FLATTREE_H_INCLUDED
+#define FLATTREE_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include "Vertex.h"
+
+/**
+ * Contiguous representation of the vertices of a tree, for decisions
+ *
+ * Each vertex is a 16 bytes node of a single array, and the two children of
+ * a split are adjacent, hence a decision is a tight loop over the array
+ * instead of a walk through pointers. The nodes are laid out in breadth-first
+ * order, which keeps the top of the tree in a few cache lines.
+ *
+ * The array is refreshed before each decision, only along the paths of the
+ * vertices marked stale since the last refresh (see Vertex#is_flat_stale).
+ * The nodes of a rebuilt subtree are appended to the array, and the whole
+ * array is laid out again once it has doubled since its last full layout.
+ */
+class FlatTree {
+	friend class QuickScorer;
+	friend class SharedTreeWriter;
+
+	public:
+		/// Kinds of node
+		enum node_kind : uint32_t {
+			/// Leaf giving a negative decision
+			LEAF_FALSE = 0,
+			/// Leaf giving a positive decision
+			LEAF_TRUE,
+			/// Split along a real feature, going right iif above the threshold
+			REAL_SPLIT,
+			/// Split along a boolean or classified feature, going right iif equal to the threshold
+			EQUALITY_SPLIT,
+			/// Split along a classified feature, going right iif in a subset of categories
+			SUBSET_SPLIT,
+			/// Vertex that should be read through Vertex#decision
+			DEFERRED
+		};
+
+		/// A vertex of the tree
+		struct node {
+			/// The #node_kind of the node
+			uint32_t kind;
+			/// Index of the split feature, for a split
+			uint32_t feature;
+			union {
+				/// Split threshold, for a real or equality split
+				float threshold;
+				/// Index in {@link #categories categories}, for a subset split
+				uint32_t categories_index;
+			};
+			/**
+			 * Index of the left child for a split, the right one being next to
+			 * it, or index in {@link #deferred deferred} for a deferred node
+			 */
+			uint32_t child;
+		};
+
+	private:
+		/// The nodes, the root being the first one
+		std::vector<node> nodes;
+
+		/// Categories of the right legs of the subset splits
+		std::vector<uint64_t> categories;
+
+		/**
+		 * Vertices of the deferred nodes
+		 *
+		 * A dirty vertex, or a vertex with buffered updates, has to be brought
+		 * up to date by Vertex#decision before being read, which the array
+		 * can not do.
+		 *
+		 * @note The vertices are not owned, and are not referenced anymore by
+		 * 	a node once freed
+		 */
+		std::vector<Vertex*> deferred;
+
+		/// Number of points going down the array together in FlatTree#decision_batch
+		static const size_t BATCH_BLOCK_SIZE = 16;
+
+		/**
+		 * Highest dimension for which the decision functions are compiled
+		 * with the dimension as a constant
+		 */
+		static const size_t MAX_STATIC_DIMENSION = 16;
+
+		/// Number of features of the points
+		size_t dimension;
+
+		/// Indicates whether all the features of the points are real
+		bool is_all_real;
+
+		/// Decision function for one point
+		typedef bool (FlatTree::*decision_function)(const float*) const;
+
+		/// Decision function for several points
+		typedef void (FlatTree::*batch_decision_function)(const float*, size_t, bool*) const;
+
+		/// The instantiation of FlatTree#decision_kernel for the features
+		decision_function decision_kernel_for_schema;
+
+		/**
+		 * The instantiation of FlatTree#decision_batch_kernel for the
+		 * features, for points stored one after the other
+		 */
+		batch_decision_function row_kernel_for_schema;
+
+		/**
+		 * The instantiation of FlatTree#decision_batch_kernel for the
+		 * features, for points stored feature by feature
+		 */
+		batch_decision_function column_kernel_for_schema;
+
+		/// Size of {@link #nodes nodes} after the last full layout
+		size_t nb_nodes_at_layout;
+
+		/**
+		 * Number of changes of the splits of the array
+		 *
+		 * This is increased whenever a split node is added, removed or
+		 * changed, but not when only the decision of a leaf changes.
+		 */
+		unsigned long structure_version;
+
+		/// Indicates whether a node is a split, of any kind
+		static bool is_split(const node& to_check);
+
+		/**
+		 * Write the node of a vertex
+		 *
+		 * The pair of nodes of the children is kept if they are the ones of
+		 * the previous node, else a new pair is appended. The children that
+		 * need to be written are added to @p to_write.
+		 *
+		 * @param vertex The vertex to write, whose Vertex#flat_index is set
+		 * @param to_write The vertices that remain to be written
+		 */
+		void write_node(Vertex* vertex, std::deque<Vertex*>& to_write);
+
+		/**
+		 * Decision for one point
+		 *
+		 * @tparam IS_ALL_REAL If true, the splits are all along real
+		 * 	features, hence the kind of node is only checked for being a split
+		 * @see FlatTree#decision
+		 */
+		template<bool IS_ALL_REAL>
+		bool decision_kernel(const float* features) const;
+
+		/**
+		 * Decision for several points
+		 *
+		 * @tparam DIMENSION The number of features of the points, or 0 if it
+		 * 	is only known at run time
+		 * @tparam IS_ALL_REAL If true, the splits are all along real
+		 * 	features, hence the kind of node is only checked for being a split
+		 * @tparam IS_COLUMN_MAJOR If true, the values of a feature for all
+		 * 	the points are contiguous, else the features of a point are
+		 * @see FlatTree#decision_batch
+		 */
+		template<size_t DIMENSION, bool IS_ALL_REAL, bool IS_COLUMN_MAJOR>
+		void decision_batch_kernel(const float* features, size_t nb_points, bool* decisions) const;
+
+		/**
+		 * Use the instantiations of the decision functions for a dimension
+		 *
+		 * @tparam DIMENSION The number of features of the points, or 0 if it
+		 * 	is only known at run time
+		 */
+		template<size_t DIMENSION>
+		void set_kernels();
+
+		/**
+		 * Choose the instantiations of the decision functions for the
+		 * features
+		 *
+		 * @tparam DIMENSION The highest dimension to check. The functions are
+		 * 	instantiated for every dimension up to this one
+		 */
+		template<size_t DIMENSION>
+		void pick_kernels();
+
+	public:
+		/**
+		 * Constructor of an empty FlatTree, laid out on first refresh
+		 *
+		 * The decision functions are chosen for the features of the points :
+		 * the dimension is a constant of the batch decisions for common
+		 * dimensions, and the kind of split is not checked when all the
+		 * features are real.
+		 *
+		 * @param features_types The types of the features of the points
+		 */
+		FlatTree(const std::vector<FeatureType>& features_types);
+
+		/**
+		 * Update the nodes of the stale vertices
+		 *
+		 * @param root The root vertex of the tree. It should be the same on
+		 * 	each call. No ownership is taken
+		 * @return true if any node was written
+		 */
+		bool refresh(Vertex* root);
+
+		/**
+		 * The decision associated with the given features
+		 *
+		 * @param features The features of the point to evaluate. The ownership
+		 * 	of this array is not taken by the method
+		 * @warning FlatTree#refresh should have been called since the last
+		 * 	update of the tree
+		 */
+		bool decision(const float* features) const;
+
+		/**
+		 * The decisions associated with several points
+		 *
+		 * The points go down the array together, by blocks of
+		 * #BATCH_BLOCK_SIZE : each point of the block moves one level down in
+		 * turn, and the next node and the feature it reads are prefetched,
+		 * so that the memory latency of a point is hidden by the work on the
+		 * others.
+		 *
+		 * @param features The features of the points. No ownership is taken
+		 * @param nb_points The number of points
+		 * @param is_column_major If false, the features of a point are
+		 * 	contiguous. If true, the values of a feature for all the points are
+		 * 	contiguous
+		 * @param decisions Out argument, array of at least @p nb_points
+		 * 	elements receiving the decisions
+		 * @warning FlatTree#refresh should have been called since the last
+		 * 	update of the tree
+		 */
+		void decision_batch(const float* features, size_t nb_points, bool is_column_major, bool* decisions) const;
+};
+#endif // FLATTREE_H_INCLUDED
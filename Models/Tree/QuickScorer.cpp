@@ -0,0 +1,118 @@
+#include "QuickScorer.h"
+
+#include <algorithm>
+
+QuickScorer::QuickScorer() :
+	structure_version(0),
+	is_built(false),
+	nb_words(0)
+{}
+
+void QuickScorer::refresh(const FlatTree& flat_tree)
+{
+	if(!this->is_built || this->structure_version != flat_tree.structure_version)
+		this->build(flat_tree);
+}
+
+size_t QuickScorer::add_subtree(const FlatTree& flat_tree, uint32_t index, std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>>& splits)
+{
+	const FlatTree::node& current = flat_tree.nodes[index];
+	if(!FlatTree::is_split(current))
+	{
+		this->leaves.push_back(index);
+		return 1;
+	}
+	size_t first_leaf = this->leaves.size();
+	size_t nb_under = this->add_subtree(flat_tree, current.child, splits);
+	size_t nb_over = this->add_subtree(flat_tree, current.child + 1, splits);
+	splits.push_back(std::make_pair(index, std::make_pair(first_leaf, first_leaf + nb_under)));
+	return nb_under + nb_over;
+}
+
+void QuickScorer::build(const FlatTree& flat_tree)
+{
+	this->is_built = true;
+	this->structure_version = flat_tree.structure_version;
+	this->leaves.clear();
+	this->conditions.clear();
+	std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>> splits;
+	this->add_subtree(flat_tree, 0, splits);
+	this->nb_words = (this->leaves.size() + 63) / 64;
+	this->remaining.assign(this->nb_words, 0);
+
+	// Real conditions are scanned by increasing threshold, the order of the
+	// other ones does not matter
+	std::stable_sort(splits.begin(), splits.end(), [&flat_tree](const std::pair<uint32_t, std::pair<size_t, size_t>>& left, const std::pair<uint32_t, std::pair<size_t, size_t>>& right)
+		{
+			const FlatTree::node& left_node = flat_tree.nodes[left.first];
+			const FlatTree::node& right_node = flat_tree.nodes[right.first];
+			bool is_left_real = left_node.kind == FlatTree::REAL_SPLIT;
+			bool is_right_real = right_node.kind == FlatTree::REAL_SPLIT;
+			if(is_left_real != is_right_real)
+				return is_right_real;
+			return is_left_real && left_node.threshold < right_node.threshold;
+		});
+	for(auto it = splits.begin(); it != splits.end(); it++)
+	{
+		const FlatTree::node& split = flat_tree.nodes[it->first];
+		if(split.feature >= this->conditions.size())
+			this->conditions.resize(split.feature + 1);
+		condition_list* list;
+		if(split.kind == FlatTree::REAL_SPLIT)
+		{
+			list = &this->conditions[split.feature].real;
+			list->thresholds.push_back(split.threshold);
+		}
+		else if(split.kind == FlatTree::EQUALITY_SPLIT)
+		{
+			list = &this->conditions[split.feature].equality;
+			list->thresholds.push_back(split.threshold);
+		}
+		else
+		{
+			list = &this->conditions[split.feature].subset;
+			list->categories.push_back(flat_tree.categories[split.categories_index]);
+		}
+		// Going right removes the leaves of the left subtree
+		size_t mask_start = list->masks.size();
+		list->masks.resize(mask_start + this->nb_words, ~(uint64_t)0);
+		for(size_t leaf = it->second.first; leaf < it->second.second; leaf++)
+			list->masks[mask_start + leaf / 64] &= ~((uint64_t)1 << (leaf % 64));
+	}
+}
+
+void QuickScorer::apply(const uint64_t* mask)
+{
+	for(size_t word = 0; word < this->nb_words; word++)
+		this->remaining[word] &= mask[word];
+}
+
+bool QuickScorer::decision(const FlatTree& flat_tree, const float* features)
+{
+	std::fill(this->remaining.begin(), this->remaining.end(), ~(uint64_t)0);
+	for(size_t feature = 0; feature < this->conditions.size(); feature++)
+	{
+		const float value = features[feature];
+		const feature_conditions& current = this->conditions[feature];
+		// Written as in Vertex#get_child_for, so that NaN goes right
+		for(size_t i = 0; i < current.real.thresholds.size() && !(value <= current.real.thresholds[i]); i++)
+			this->apply(&current.real.masks[i * this->nb_words]);
+		for(size_t i = 0; i < current.equality.thresholds.size(); i++)
+			if(value == current.equality.thresholds[i])
+				this->apply(&current.equality.masks[i * this->nb_words]);
+		for(size_t i = 0; i < current.subset.categories.size(); i++)
+			if(PointSet::is_in_categories(current.subset.categories[i], value))
+				this->apply(&current.subset.masks[i * this->nb_words]);
+	}
+	// The exit leaf is the leftmost remaining one
+	size_t word = 0;
+	while(this->remaining[word] == 0)
+		word++;
+	size_t leaf = word * 64;
+	for(uint64_t bits = this->remaining[word]; (bits & 1) == 0; bits >>= 1)
+		leaf++;
+	const FlatTree::node& exit_node = flat_tree.nodes[this->leaves[leaf]];
+	if(exit_node.kind == FlatTree::DEFERRED)
+		return flat_tree.deferred[exit_node.child]->decision(features);
+	return exit_node.kind == FlatTree::LEAF_TRUE;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file QuickScorer.h
+ * Definition of class QuickScorer
+ */
+#ifndef QUICKSCORER_H_INCLUDED
+#define QUICKSCORER_H_INCLUDED
+
+#include <vector>
+#include <cstdint>
+#include "FlatTree.h"
+
+/**
+ * Decisions made by bitvectors, as in the QuickScorer algorithm
+ *
+ * The leaves of the tree are numbered from left to right, and a set of
+ * leaves is a bitvector. Each split is a condition on a feature which, when
+ * the point goes right, removes the leaves of the left subtree. The
+ * conditions are grouped by feature, and the real ones are sorted by
+ * threshold, hence scoring a point is scanning, for each feature, the
+ * thresholds below its value and ANDing their bitvectors. The exit leaf is
+ * the leftmost remaining one. There is no branch depending on the path of
+ * the point, which suits shallow trees and batches.
+ *
+ * The conditions are made from a FlatTree, and made again only when its
+ * splits change, i.e. after builds. The decisions of the leaves are read
+ * from the FlatTree, hence stay up to date between builds.
+ */
+class QuickScorer {
+	private:
+		/// The conditions of one kind along one feature
+		struct condition_list {
+			/**
+			 * Thresholds of the real or equality conditions
+			 *
+			 * The real conditions are sorted in increasing order, and the
+			 * equality conditions in any order.
+			 */
+			std::vector<float> thresholds;
+			/// Categories of the subset conditions
+			std::vector<uint64_t> categories;
+			/**
+			 * Bitvectors of the leaves kept when the condition holds, of
+			 * {@link #nb_words nb_words} words each, in the order of the
+			 * conditions
+			 */
+			std::vector<uint64_t> masks;
+		};
+
+		/// The conditions of the splits along one feature
+		struct feature_conditions {
+			/// Splits along a real feature, holding iif above the threshold
+			condition_list real;
+			/// Splits holding iif equal to the threshold
+			condition_list equality;
+			/// Splits holding iif in a subset of categories
+			condition_list subset;
+		};
+
+		/// Value of FlatTree#structure_version when the conditions were made
+		unsigned long structure_version;
+
+		/// Indicates whether the conditions have been made at least once
+		bool is_built;
+
+		/// The conditions, by feature
+		std::vector<feature_conditions> conditions;
+
+		/// Index in FlatTree#nodes of each leaf, from left to right
+		std::vector<uint32_t> leaves;
+
+		/// Number of 64 bits words of a bitvector of leaves
+		size_t nb_words;
+
+		/// Bitvector of the leaves remaining during a decision
+		std::vector<uint64_t> remaining;
+
+		/**
+		 * Make the conditions of a subtree of the FlatTree
+		 *
+		 * @param flat_tree The array of which decisions are made
+		 * @param index Index of the root of the subtree in FlatTree#nodes
+		 * @param splits Out argument, the splits of the subtree with the
+		 * 	index of their first leaf and of the first leaf of their right
+		 * 	subtree
+		 * @return The number of leaves of the subtree
+		 */
+		size_t add_subtree(const FlatTree& flat_tree, uint32_t index, std::vector<std::pair<uint32_t, std::pair<size_t, size_t>>>& splits);
+
+		/**
+		 * Make the conditions again from the FlatTree
+		 *
+		 * @param flat_tree The array of which decisions are made
+		 */
+		void build(const FlatTree& flat_tree);
+
+		/// AND the bitvector of a condition into {@link #remaining remaining}
+		void apply(const uint64_t* mask);
+
+	public:
+		/**
+		 * Constructor of QuickScorer
+		 *
+		 * The conditions are made by the first call to QuickScorer#refresh.
+		 */
+		QuickScorer();
+
+		/**
+		 * Make the conditions again if the splits of the FlatTree changed
+		 *
+		 * @param flat_tree The array of which decisions are made. It should
+		 * 	be the same on each call
+		 * @warning FlatTree#refresh should have been called first
+		 */
+		void refresh(const FlatTree& flat_tree);
+
+		/**
+		 * The decision associated with the given features
+		 *
+		 * @param flat_tree The array from which the conditions were made
+		 * @param features The features of the point to evaluate. The ownership
+		 * 	of this array is not taken by the method
+		 * @warning QuickScorer#refresh should have been called since the last
+		 * 	update of the tree
+		 */
+		bool decision(const FlatTree& flat_tree, const float* features);
+};
+#endif // QUICKSCORER_H_INCLUDED
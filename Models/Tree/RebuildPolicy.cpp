@@ -0,0 +1,100 @@
+#include "RebuildPolicy.h"
+#include "Vertex.h"
+
+#include <algorithm>
+
+bool RebuildPolicy::is_batch_rebuild_needed(Vertex& vertex, const std::vector<std::pair<Point*, bool>>& updates)
+{
+	bool is_needed = false;
+	for(auto it = updates.begin(); it != updates.end(); it++)
+		is_needed = this->is_rebuild_needed(vertex, it->first, it->second) || is_needed;
+	return is_needed;
+}
+
+RebuildPolicy* EpsilonRebuildPolicy::clone() const
+{
+	return new EpsilonRebuildPolicy();
+}
+
+void EpsilonRebuildPolicy::reset(Vertex&)
+{}
+
+bool EpsilonRebuildPolicy::is_rebuild_needed(Vertex& vertex, Point*, bool)
+{
+	return vertex.get_updates_since_last_build() >= vertex.get_epsilon()*vertex.get_size_at_building()
+		&& (!vertex.get_use_certificate() || vertex.get_updates_since_last_build() > vertex.get_certified_updates());
+}
+
+bool EpsilonRebuildPolicy::is_batch_rebuild_needed(Vertex& vertex, const std::vector<std::pair<Point*, bool>>& updates)
+{
+	return this->is_rebuild_needed(vertex, updates.back().first, updates.back().second);
+}
+
+PageHinkley::PageHinkley(double delta, double lambda, unsigned int min_values, bool is_two_sided) :
+	delta(delta),
+	lambda(lambda),
+	min_values(min_values),
+	is_two_sided(is_two_sided)
+{
+	this->reset();
+}
+
+void PageHinkley::reset()
+{
+	this->nb_values = 0;
+	this->mean = 0;
+	this->sum_increase = 0;
+	this->min_sum_increase = 0;
+	this->sum_decrease = 0;
+	this->max_sum_decrease = 0;
+}
+
+bool PageHinkley::add_value(double value)
+{
+	this->nb_values++;
+	this->mean += (value - this->mean)/this->nb_values;
+	this->sum_increase += value - this->mean - this->delta;
+	this->min_sum_increase = std::min(this->min_sum_increase, this->sum_increase);
+	this->sum_decrease += value - this->mean + this->delta;
+	this->max_sum_decrease = std::max(this->max_sum_decrease, this->sum_decrease);
+	if(this->nb_values < this->min_values)
+		return false;
+	return this->sum_increase - this->min_sum_increase > this->lambda
+		|| (this->is_two_sided && this->max_sum_decrease - this->sum_decrease > this->lambda);
+}
+
+DriftRebuildPolicy::DriftRebuildPolicy(double delta, double lambda, unsigned int min_updates) :
+	label_test(delta, lambda, min_updates, true),
+	gain_test(delta, lambda, min_updates, false),
+	gain_at_building(0)
+{}
+
+RebuildPolicy* DriftRebuildPolicy::clone() const
+{
+	DriftRebuildPolicy* to_return = new DriftRebuildPolicy(*this);
+	to_return->label_test.reset();
+	to_return->gain_test.reset();
+	to_return->gain_at_building = 0;
+	return to_return;
+}
+
+void DriftRebuildPolicy::reset(Vertex& vertex)
+{
+	this->label_test.reset();
+	this->gain_test.reset();
+	this->gain_at_building = vertex.get_split_gain();
+}
+
+bool DriftRebuildPolicy::is_rebuild_needed(Vertex& vertex, Point*, bool)
+{
+	// In any case, the vertex is rebuilt once all its points may have changed
+	if(vertex.get_updates_since_last_build() >= vertex.get_size_at_building())
+		return true;
+	// Deletions shift the labels of the vertex as much as additions
+	bool is_drift = this->label_test.add_value(vertex.get_positive_proportion());
+	// The gain of the split is only available once the children are updated,
+	// hence it lags by one update, which does not matter for detection
+	if(this->gain_at_building > 0)
+		is_drift = this->gain_test.add_value(1 - vertex.get_split_gain()/this->gain_at_building) || is_drift;
+	return is_drift;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file RebuildPolicy.h
+ * Definition of the policies deciding when to rebuild a Vertex
+ */
+#ifndef REBUILDPOLICY_H_INCLUDED
+#define REBUILDPOLICY_H_INCLUDED
+
+#include <utility>
+#include <vector>
+#include "../PointSet/Point.h"
+
+class Vertex;
+
+/**
+ * Policy deciding when a Vertex should be rebuilt
+ *
+ * Each vertex owns its own instance of the policy, which may hence keep a
+ * state related to the vertex. The instances of the vertices created by a
+ * build are made by cloning the instance of their parent.
+ */
+class RebuildPolicy {
+	public:
+		/// Destructor of RebuildPolicy
+		virtual ~RebuildPolicy() {};
+
+		/**
+		 * Create a new instance of the policy with the same settings
+		 *
+		 * The state related to the vertex is not copied, the new instance is
+		 * meant for another vertex.
+		 *
+		 * @note This gives ownership of the returned policy
+		 */
+		virtual RebuildPolicy* clone() const = 0;
+
+		/**
+		 * Reset the state of the policy after a build of the vertex
+		 *
+		 * @param vertex The vertex that has just been built
+		 */
+		virtual void reset(Vertex& vertex) = 0;
+
+		/**
+		 * Decide whether the vertex should be rebuilt after an update
+		 *
+		 * This is called once the update has been counted by the vertex, and
+		 * before it is propagated to the children.
+		 *
+		 * @param vertex The vertex that has been updated
+		 * @param point The point added or removed. No ownership is taken
+		 * @param is_add True if the point has been added, false if it has been
+		 * 	removed
+		 */
+		virtual bool is_rebuild_needed(Vertex& vertex, Point* point, bool is_add) = 0;
+
+		/**
+		 * Decide whether the vertex should be rebuilt after a batch of updates
+		 *
+		 * This is called once the whole batch has been counted by the vertex,
+		 * and before it is propagated to the children. By default, each update
+		 * is given to RebuildPolicy#is_rebuild_needed, so that the state of the
+		 * policy sees all of them, and a rebuild is needed if any of them needs
+		 * it.
+		 *
+		 * @param vertex The vertex that has been updated
+		 * @param updates The points added (true) or removed (false), not empty
+		 */
+		virtual bool is_batch_rebuild_needed(Vertex& vertex, const std::vector<std::pair<Point*, bool>>& updates);
+
+		/**
+		 * Indicates whether the policy only reads the vertex it decides for
+		 *
+		 * A policy reading the children of the vertex can not be used with
+		 * concurrent writers, which only lock the vertex being updated.
+		 *
+		 * @see Vertex#update_concurrently
+		 */
+		virtual bool is_local() const {return false;};
+};
+
+/**
+ * The rebuild rule of the algorithm
+ *
+ * The vertex is rebuilt after epsilon times its size at building updates,
+ * delayed by its certificate when certificates are used.
+ *
+ * @see TreeConfig#use_certificate
+ */
+class EpsilonRebuildPolicy : public RebuildPolicy {
+	public:
+		RebuildPolicy* clone() const;
+		void reset(Vertex& vertex);
+		bool is_rebuild_needed(Vertex& vertex, Point* point, bool is_add);
+
+		/// The rule only depends on the number of updates, hence it is checked once
+		bool is_batch_rebuild_needed(Vertex& vertex, const std::vector<std::pair<Point*, bool>>& updates);
+
+		bool is_local() const {return true;};
+};
+
+/**
+ * Page-Hinkley test detecting a change in the mean of a sequence
+ *
+ * The test accumulates the deviations of the values from their running mean,
+ * minus a tolerance, and detects a change when the accumulated deviation
+ * drifts away from its extremum by more than a threshold.
+ */
+class PageHinkley {
+	private:
+		/// Tolerated magnitude of changes
+		double delta;
+
+		/// Detection threshold
+		double lambda;
+
+		/// Minimal number of values before a change can be detected
+		unsigned int min_values;
+
+		/// Indicates whether decreases of the mean should also be detected
+		bool is_two_sided;
+
+		/// Number of values observed since the last reset
+		unsigned int nb_values;
+
+		/// Mean of the values observed since the last reset
+		double mean;
+
+		/// Accumulated deviations, for detecting increases
+		double sum_increase;
+
+		/// Minimum of sum_increase
+		double min_sum_increase;
+
+		/// Accumulated deviations, for detecting decreases
+		double sum_decrease;
+
+		/// Maximum of sum_decrease
+		double max_sum_decrease;
+
+	public:
+		/**
+		 * Main constructor of PageHinkley
+		 *
+		 * @param delta Tolerated magnitude of changes
+		 * @param lambda Detection threshold
+		 * @param min_values Minimal number of values before a change can be
+		 * 	detected
+		 * @param is_two_sided If true, decreases of the mean are detected as
+		 * 	well as increases
+		 */
+		PageHinkley(double delta, double lambda, unsigned int min_values, bool is_two_sided);
+
+		/// Forget all the values observed so far
+		void reset();
+
+		/**
+		 * Observe a new value of the sequence
+		 *
+		 * @param value The new value
+		 * @return true if a change of the mean is detected
+		 */
+		bool add_value(double value);
+};
+
+/**
+ * Rebuild policy triggered by concept drift
+ *
+ * Two Page-Hinkley tests watch the vertex : one on its proportion of positive
+ * points, fed on every update, and one on the relative loss of gain of its
+ * split, computed from the children. The vertex is rebuilt when one of them detects a change,
+ * and in any case once as many updates as its size at building have been
+ * made.
+ */
+class DriftRebuildPolicy : public RebuildPolicy {
+	private:
+		/// Test on the proportion of positive points of the vertex
+		PageHinkley label_test;
+
+		/// Test on the relative loss of gain of the split
+		PageHinkley gain_test;
+
+		/// Gain of the split when the vertex has been built
+		double gain_at_building;
+
+	public:
+		/**
+		 * Main constructor of DriftRebuildPolicy
+		 *
+		 * @param delta Tolerated magnitude of changes, for both tests
+		 * @param lambda Detection threshold, for both tests
+		 * @param min_updates Minimal number of updates before a drift can be
+		 * 	detected
+		 */
+		DriftRebuildPolicy(double delta, double lambda, unsigned int min_updates);
+
+		RebuildPolicy* clone() const;
+		void reset(Vertex& vertex);
+		bool is_rebuild_needed(Vertex& vertex, Point* point, bool is_add);
+};
+#endif // REBUILDPOLICY_H_INCLUDED
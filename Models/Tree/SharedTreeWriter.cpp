@@ -0,0 +1,95 @@
+#include "SharedTreeWriter.h"
+
+#include <new>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedTreeWriter::SharedTreeWriter(const std::string& name, size_t dimension, uint32_t node_capacity, uint32_t categories_capacity) :
+	name(name),
+	segment(MAP_FAILED),
+	segment_size(TreeReader::get_segment_size(node_capacity, categories_capacity)),
+	header(NULL)
+{
+	// Readers of a previous segment keep their mapping, and new readers
+	// only see this one once initialised
+	shm_unlink(name.c_str());
+	int descriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(descriptor == -1)
+		throw std::runtime_error("Error : could not create the shared memory " + name);
+	if(ftruncate(descriptor, this->segment_size) == 0)
+		this->segment = mmap(NULL, this->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if(this->segment == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		throw std::runtime_error("Error : could not map the shared memory " + name);
+	}
+	// The segment is zeroed, hence the buffers are empty and not being written
+	this->header = new(this->segment) TreeReader::shared_header();
+	this->header->dimension = dimension;
+	this->header->node_capacity = node_capacity;
+	this->header->categories_capacity = categories_capacity;
+	this->header->version.store(0);
+	this->header->magic.store(TreeReader::MAGIC, std::memory_order_release);
+}
+
+SharedTreeWriter::~SharedTreeWriter()
+{
+	munmap(this->segment, this->segment_size);
+	shm_unlink(this->name.c_str());
+}
+
+void SharedTreeWriter::publish(const FlatTree& flat_tree)
+{
+	// Breadth-first order of the nodes, those of replaced subtrees being left
+	// out. The nodes are checked before the buffer is written
+	this->to_copy.assign(1, 0);
+	uint32_t nb_categories = 0;
+	for(size_t i = 0; i < this->to_copy.size(); i++)
+	{
+		const FlatTree::node& current = flat_tree.nodes[this->to_copy[i]];
+		if(current.kind == FlatTree::DEFERRED)
+			throw std::runtime_error("Error : a tree with dirty vertices can not be shared");
+		nb_categories += current.kind == FlatTree::SUBSET_SPLIT;
+		if(FlatTree::is_split(current))
+		{
+			this->to_copy.push_back(current.child);
+			this->to_copy.push_back(current.child + 1);
+		}
+	}
+	if(this->to_copy.size() > this->header->node_capacity || nb_categories > this->header->categories_capacity)
+		throw std::runtime_error("Error : the tree exceeds the capacity of the shared memory " + this->name);
+
+	uint64_t version = this->header->version.load(std::memory_order_relaxed);
+	TreeReader::shared_buffer* buffer = TreeReader::get_buffer(this->header, (version + 1) % 2);
+	FlatTree::node* nodes = TreeReader::get_nodes(buffer);
+	uint64_t* categories = TreeReader::get_categories(this->header, buffer);
+	uint64_t sequence = buffer->sequence.load(std::memory_order_relaxed);
+	buffer->sequence.store(sequence + 1, std::memory_order_relaxed);
+	// The nodes should not be written before the sequence is odd
+	std::atomic_thread_fence(std::memory_order_release);
+
+	// The children of the i-th split copied are the (2i+1)-th and (2i+2)-th
+	// nodes of the order
+	uint32_t nb_splits = 0;
+	nb_categories = 0;
+	for(size_t i = 0; i < this->to_copy.size(); i++)
+	{
+		FlatTree::node current = flat_tree.nodes[this->to_copy[i]];
+		if(current.kind == FlatTree::SUBSET_SPLIT)
+		{
+			categories[nb_categories] = flat_tree.categories[current.categories_index];
+			current.categories_index = nb_categories++;
+		}
+		if(FlatTree::is_split(current))
+			current.child = 2 * nb_splits++ + 1;
+		nodes[i] = current;
+	}
+	buffer->nb_nodes = this->to_copy.size();
+	buffer->nb_categories = nb_categories;
+
+	buffer->sequence.store(sequence + 2, std::memory_order_release);
+	this->header->version.store(version + 1, std::memory_order_release);
+}
@@ -0,0 +1,83 @@
+/**
+ * @file SharedTreeWriter.h
+ * Definition of class SharedTreeWriter
+ */
+#ifndef SHAREDTREEWRITER_H_INCLUDED
+#define SHAREDTREEWRITER_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "FlatTree.h"
+#include "TreeReader.h"
+
+/**
+ * Publisher of a FlatTree in POSIX shared memory, for TreeReader instances
+ * of other processes
+ *
+ * The nodes reachable from the root are copied into the buffer of the
+ * segment that was not published last, laid out again from index 0, and the
+ * buffer is then published by increasing the version of the segment (see
+ * TreeReader for the protocol).
+ */
+class SharedTreeWriter {
+	private:
+		/// Name of the POSIX shared memory object
+		std::string name;
+
+		/// The mapped segment
+		void* segment;
+
+		/// Size of the mapped segment
+		size_t segment_size;
+
+		/// The header of the mapped segment
+		TreeReader::shared_header* header;
+
+		/// Index in FlatTree#nodes of the nodes being copied, by new index
+		std::vector<uint32_t> to_copy;
+
+	public:
+		/**
+		 * Create a segment and map it
+		 *
+		 * A segment of the same name is replaced.
+		 *
+		 * @param name Name of the POSIX shared memory object, starting with
+		 * 	'/'
+		 * @param dimension Number of features of the points
+		 * @param node_capacity Maximal number of nodes of a published tree
+		 * @param categories_capacity Maximal number of subset splits of a
+		 * 	published tree
+		 * @throw std::runtime_error When the segment could not be created
+		 */
+		SharedTreeWriter(const std::string& name, size_t dimension, uint32_t node_capacity, uint32_t categories_capacity);
+
+		/// Copying would remove the segment twice
+		SharedTreeWriter(const SharedTreeWriter&) = delete;
+
+		/// Copying would remove the segment twice
+		SharedTreeWriter& operator=(const SharedTreeWriter&) = delete;
+
+		/**
+		 * Destructor of SharedTreeWriter
+		 *
+		 * Unmap the segment and remove its name. The readers that mapped it
+		 * keep reading the last published tree.
+		 */
+		~SharedTreeWriter();
+
+		/// Indicates whether a tree has been published
+		bool is_published() const {return this->header->version.load() != 0;};
+
+		/**
+		 * Publish the nodes of a FlatTree
+		 *
+		 * @param flat_tree The FlatTree to copy. It should be refreshed and
+		 * 	without deferred nodes. No ownership is taken
+		 * @throw std::runtime_error When the tree exceeds the capacity of the
+		 * 	segment, or has a deferred node
+		 */
+		void publish(const FlatTree& flat_tree);
+};
+#endif // SHAREDTREEWRITER_H_INCLUDED
@@ -0,0 +1,103 @@
+#include "SnapshotPublisher.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+SnapshotPublisher::SnapshotPublisher() :
+	current(NULL),
+	global_epoch(1)
+{
+	for(size_t i = 0; i < NB_READER_SLOTS; i++)
+		this->slots[i].epoch.store(0);
+}
+
+SnapshotPublisher::~SnapshotPublisher()
+{
+	delete this->current.load();
+	for(auto it = this->retired.begin(); it != this->retired.end(); it++)
+		delete it->first;
+	for(auto it = this->available.begin(); it != this->available.end(); it++)
+		delete *it;
+}
+
+size_t SnapshotPublisher::enter()
+{
+	// Each thread starts looking from its own slot, so that readers do not
+	// contend for the same ones
+	static thread_local size_t first_slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % NB_READER_SLOTS;
+	size_t slot = first_slot;
+	while(true)
+	{
+		unsigned long expected = 0;
+		// The epoch may be outdated once announced, which only delays the
+		// reclamation
+		if(this->slots[slot].epoch.compare_exchange_strong(expected, this->global_epoch.load()))
+			return slot;
+		slot = (slot + 1) % NB_READER_SLOTS;
+		if(slot == first_slot)
+			std::this_thread::yield();
+	}
+}
+
+void SnapshotPublisher::leave(size_t slot)
+{
+	this->slots[slot].epoch.store(0, std::memory_order_release);
+}
+
+void SnapshotPublisher::reclaim()
+{
+	unsigned long oldest_epoch = this->global_epoch.load();
+	for(size_t i = 0; i < NB_READER_SLOTS; i++)
+	{
+		unsigned long epoch = this->slots[i].epoch.load();
+		if(epoch != 0)
+			oldest_epoch = std::min(oldest_epoch, epoch);
+	}
+	// A reader that announced an epoch after the replacement of a copy loads
+	// a newer one
+	auto it = this->retired.begin();
+	while(it != this->retired.end())
+	{
+		if(it->second < oldest_epoch)
+		{
+			this->available.push_back(it->first);
+			it = this->retired.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
+void SnapshotPublisher::publish(const FlatTree& flat_tree)
+{
+	FlatTree* copy;
+	if(this->available.empty())
+		copy = new FlatTree(flat_tree);
+	else
+	{
+		// Assigning keeps the memory of the arrays when large enough
+		copy = this->available.back();
+		this->available.pop_back();
+		*copy = flat_tree;
+	}
+	const FlatTree* replaced = this->current.exchange(copy);
+	if(replaced != NULL)
+		this->retired.push_back(std::make_pair(const_cast<FlatTree*>(replaced), this->global_epoch.fetch_add(1)));
+	this->reclaim();
+}
+
+bool SnapshotPublisher::decision(const float* features)
+{
+	size_t slot = this->enter();
+	bool result = this->current.load()->decision(features);
+	this->leave(slot);
+	return result;
+}
+
+void SnapshotPublisher::decision_batch(const float* features, size_t nb_points, bool is_column_major, bool* decisions)
+{
+	size_t slot = this->enter();
+	this->current.load()->decision_batch(features, nb_points, is_column_major, decisions);
+	this->leave(slot);
+}
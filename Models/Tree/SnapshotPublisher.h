@@ -0,0 +1,146 @@
+/**
+ * @file SnapshotPublisher.h
+ * Definition of class SnapshotPublisher
+ */
+#ifndef SNAPSHOTPUBLISHER_H_INCLUDED
+#define SNAPSHOTPUBLISHER_H_INCLUDED
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include "FlatTree.h"
+
+/**
+ * Copies of a FlatTree published by one writer thread to reader threads
+ *
+ * The writer publishes a copy of its FlatTree by swapping an atomic pointer,
+ * and readers make decisions on the copy they loaded without taking a lock.
+ * A copy that has been replaced is only reused once no reader may still be
+ * reading it, which is found by epoch-based reclamation : each reader
+ * announces the epoch at which it started in a slot, and a copy replaced at
+ * an epoch is reclaimed once all the announced epochs are above it.
+ *
+ * The published copies should not defer any decision to the vertices (see
+ * FlatTree#deferred), hence readers never access the vertices nor the
+ * points, which can be freed by the writer at any time.
+ */
+class SnapshotPublisher {
+	private:
+		/// Maximal number of readers reading at the same time
+		static const size_t NB_READER_SLOTS = 64;
+
+		/// Size of a cache line, so that readers do not share their slots
+		static const size_t CACHE_LINE_SIZE = 64;
+
+		/// Epoch announced by a reader, alone in its cache line
+		struct reader_slot {
+			/// The epoch at which the reader started, or 0 if the slot is free
+			std::atomic<unsigned long> epoch;
+			/// Padding up to the next slot
+			char padding[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned long>)];
+		};
+
+		/// The copy read by new readers, or NULL before the first publication
+		std::atomic<const FlatTree*> current;
+
+		/// Epoch increased at each publication, starting at 1
+		std::atomic<unsigned long> global_epoch;
+
+		/// The slots of the readers
+		reader_slot slots[NB_READER_SLOTS];
+
+		/**
+		 * Copies replaced and the epoch of their replacement, that may still
+		 * be read
+		 *
+		 * @note Only accessed by the writer
+		 */
+		std::vector<std::pair<FlatTree*, unsigned long>> retired;
+
+		/**
+		 * Copies that no reader can read anymore, reused by the next
+		 * publications
+		 *
+		 * @note Only accessed by the writer
+		 */
+		std::vector<FlatTree*> available;
+
+		/**
+		 * Announce a reader
+		 *
+		 * @return The slot of the reader, to give to SnapshotPublisher#leave
+		 */
+		size_t enter();
+
+		/**
+		 * Withdraw a reader
+		 *
+		 * @param slot The slot given by SnapshotPublisher#enter
+		 */
+		void leave(size_t slot);
+
+		/// Move the retired copies that no reader can read to the available ones
+		void reclaim();
+
+	public:
+		/// Constructor of SnapshotPublisher, without any copy published
+		SnapshotPublisher();
+
+		/// Copying would free the copies twice
+		SnapshotPublisher(const SnapshotPublisher&) = delete;
+
+		/// Copying would free the copies twice
+		SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+		/**
+		 * Destructor of SnapshotPublisher
+		 *
+		 * Free memory of all the copies
+		 *
+		 * @warning No reader should be reading
+		 */
+		~SnapshotPublisher();
+
+		/**
+		 * Indicates whether a copy has been published
+		 *
+		 * @note Only to be called by the writer
+		 */
+		bool is_published() const {return this->current.load() != NULL;};
+
+		/**
+		 * Publish a copy of a FlatTree for the next readers
+		 *
+		 * The memory of a copy that no reader can read anymore is reused.
+		 *
+		 * @param flat_tree The FlatTree to copy. It should be refreshed and
+		 * 	without deferred nodes. No ownership is taken
+		 * @note Only to be called by the writer
+		 */
+		void publish(const FlatTree& flat_tree);
+
+		/**
+		 * The decision of the last published copy for the given features
+		 *
+		 * This can be called by any number of threads at the same time as
+		 * SnapshotPublisher#publish, without taking a lock.
+		 *
+		 * @param features The features of the point to evaluate. No ownership
+		 * 	is taken
+		 * @warning A copy should have been published
+		 * @see FlatTree#decision
+		 */
+		bool decision(const float* features);
+
+		/**
+		 * The decisions of the last published copy for several points
+		 *
+		 * This can be called by any number of threads at the same time as
+		 * SnapshotPublisher#publish, without taking a lock.
+		 *
+		 * @warning A copy should have been published
+		 * @see FlatTree#decision_batch
+		 */
+		void decision_batch(const float* features, size_t nb_points, bool is_column_major, bool* decisions);
+};
+#endif // SNAPSHOTPUBLISHER_H_INCLUDED
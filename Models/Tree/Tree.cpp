@@ -1,52 +1,254 @@
 #include "Tree.h"
+#include <algorithm>
+#include <new>
 #include <numeric>
+#include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
+#include <thread>
 
 Tree::Tree(std::multiset<Point*> list_of_points, size_t dimension, unsigned int max_height, float epsilon, unsigned int min_split_points,	float min_split_gini, float epsilon_transmission, std::vector<FeatureType> features_types):
+	features_types(features_types),
+	flat_tree(features_types),
+	snapshots(NULL),
+	use_concurrent_readers(false),
+	shared_writer(NULL),
 	list_of_points(list_of_points.begin(), list_of_points.end()),
 	dimension(dimension),
 	max_height(max_height),
-	epsilon(epsilon),
-	min_split_points(min_split_points),
-	min_split_gini(min_split_gini),
-	epsilon_transmission(epsilon_transmission)
+	config(new TreeConfig(epsilon, epsilon_transmission, min_split_points, min_split_gini)),
+	points_mutex(NULL),
+	point_block(NULL),
+	point_block_size(0),
+	relocation_ratio(0),
+	nb_added_since_relocation(0),
+	window_start(0)
 {
 	std::vector<bool> relevant_features(dimension, true);
 	PointSet* first_set = new PointSet(list_of_points, dimension, features_types, relevant_features);
-	this->root = new Vertex(first_set, NULL, max_height-1, epsilon, min_split_points, min_split_gini, epsilon_transmission, true);
+	this->root = new(this->config->arena.allocate()) Vertex(first_set, NULL, max_height-1, this->config, true);
 }
 
 Tree::Tree(const Tree& source, float epsilon, float epsilon_transmission) :
+	features_types(source.features_types),
+	flat_tree(source.features_types),
+	snapshots(NULL),
+	use_concurrent_readers(false),
+	shared_writer(NULL),
 	list_of_points(),
 	dimension(source.dimension),
 	max_height(source.max_height),
-	epsilon(epsilon),
-	min_split_points(source.min_split_points),
-	min_split_gini(source.min_split_gini),
-	epsilon_transmission(epsilon_transmission)
+	config(new TreeConfig(*source.config, epsilon, epsilon_transmission)),
+	points_mutex(NULL),
+	point_block(NULL),
+	point_block_size(0),
+	relocation_ratio(0),
+	nb_added_since_relocation(0),
+	window_start(source.window_start)
 {
+	std::unordered_map<Point*, Point*> copies;
 	for(auto it = source.list_of_points.begin(); it != source.list_of_points.end(); it++)
 	{
 		Point* new_point = new Point(**it);
 		this->list_of_points.insert(new_point);
+		if(!source.window.empty())
+			copies[*it] = new_point;
 	}
-	this->root = new Vertex(*source.root, epsilon, epsilon_transmission, std::multiset<Point*>(this->list_of_points.begin(), this->list_of_points.end()));
+	for(auto it = source.window.begin(); it != source.window.end(); it++)
+		this->window.push_back(*it == NULL ? NULL : copies.at(*it));
+	this->index_window();
+	this->root = new(this->config->arena.allocate()) Vertex(*source.root, this->config, std::multiset<Point*>(this->list_of_points.begin(), this->list_of_points.end()));
 }
 
 Tree::~Tree()
 {
-	delete this->root;
+	delete this->snapshots;
+	delete this->points_mutex;
+	delete this->shared_writer;
+	Vertex::destroy(this->root);
+	// Cancelled background builds may still read the points, and free their
+	// shadow in the arena
+	while(this->config->nb_background_builds > 0)
+		std::this_thread::yield();
+	delete this->config;
 	for(auto it = this->list_of_points.begin(); it != this->list_of_points.end(); it++)
-		delete *it;
-	
+		this->free_point(*it);
+	for(auto it = this->retired_points.begin(); it != this->retired_points.end(); it++)
+		this->free_point(*it);
+	delete [] this->point_block;
+}
+
+void Tree::free_point(Point* old_point)
+{
+	char* address = (char*)old_point;
+	if(address >= this->point_block && address < this->point_block + this->point_block_size)
+		old_point->~Point();
+	else
+		delete old_point;
+}
+
+void Tree::retire_point(Point* old_point)
+{
+	this->retired_points.push_back(old_point);
+	// Buffered deletions and tombstones can be applied on demand, which
+	// bounds the number of points kept
+	if(this->retired_points.size() >= this->list_of_points.size())
+	{
+		if(this->config->nb_buffered_deletions > 0)
+			this->root->flush();
+		this->compact();
+	}
+	else
+		this->free_retired_points();
+}
+
+void Tree::unlink_from_window(Point* old_point)
+{
+	auto it = this->window_positions.find(old_point);
+	if(it == this->window_positions.end())
+		return;
+	this->window[it->second] = NULL;
+	this->window_positions.erase(it);
+}
+
+void Tree::index_window()
+{
+	this->window_positions.clear();
+	for(size_t i = 0; i < this->window.size(); i++)
+		if(this->window[i] != NULL)
+			this->window_positions[this->window[i]] = i;
+}
+
+void Tree::free_retired_points()
+{
+	if(this->config->nb_pending_rebuilds > 0 || this->config->nb_buffered_deletions > 0 || this->config->nb_tombstones > 0)
+		return;
+	for(auto it = this->retired_points.begin(); it != this->retired_points.end(); it++)
+		this->free_point(*it);
+	this->retired_points.clear();
+}
+
+void Tree::check_no_concurrent_writers(const std::string& setting) const
+{
+	if(this->config->use_concurrent_writers)
+		throw std::runtime_error("Error : " + setting + " can not be used with concurrent writers");
+}
+
+void Tree::check_not_published(const std::string& setting) const
+{
+	if(this->use_concurrent_readers || this->shared_writer != NULL)
+		throw std::runtime_error("Error : " + setting + " can not be used with concurrent readers nor shared memory");
+}
+
+void Tree::compact()
+{
+	if(this->config->nb_tombstones > 0)
+		this->root->compact();
+	this->free_retired_points();
+}
+
+void Tree::relocate_points()
+{
+	if(this->config->nb_pending_rebuilds > 0 || this->config->nb_background_builds > 0)
+		return;
+	// The leaves may still hold deleted points, which are ignored, and the
+	// buffered points may not be in a leaf yet, which are placed after the
+	// others, as are the deleted points that are not freed yet
+	std::unordered_set<Point*> remaining_points(this->list_of_points.begin(), this->list_of_points.end());
+	remaining_points.insert(this->retired_points.begin(), this->retired_points.end());
+	std::vector<Point*> leaf_points;
+	leaf_points.reserve(remaining_points.size());
+	this->root->append_leaf_points(leaf_points);
+	std::vector<Point*> old_points;
+	old_points.reserve(remaining_points.size());
+	for(auto it = leaf_points.begin(); it != leaf_points.end(); it++)
+		if(remaining_points.erase(*it) > 0)
+			old_points.push_back(*it);
+	for(auto it = this->list_of_points.begin(); it != this->list_of_points.end(); it++)
+		if(remaining_points.erase(*it) > 0)
+			old_points.push_back(*it);
+	for(auto it = this->retired_points.begin(); it != this->retired_points.end(); it++)
+		if(remaining_points.erase(*it) > 0)
+			old_points.push_back(*it);
+
+	// Each point is followed by its features
+	size_t slot_size = (sizeof(Point) + this->dimension * sizeof(float) + alignof(Point) - 1) / alignof(Point) * alignof(Point);
+	size_t new_block_size = old_points.size() * slot_size;
+	char* new_block = new char[new_block_size];
+	std::unordered_map<Point*, Point*> relocated(old_points.size());
+	for(size_t i = 0; i < old_points.size(); i++)
+	{
+		char* slot = new_block + i * slot_size;
+		relocated[old_points[i]] = new(slot) Point(*old_points[i], (float*)(slot + sizeof(Point)));
+	}
+	this->root->relocate_points(relocated);
+	std::multiset<Point*, point_ptr_compare> new_list_of_points;
+	for(auto it = this->list_of_points.begin(); it != this->list_of_points.end(); it++)
+		new_list_of_points.insert(new_list_of_points.end(), relocated.at(*it));
+	this->list_of_points.swap(new_list_of_points);
+	for(auto it = this->retired_points.begin(); it != this->retired_points.end(); it++)
+		*it = relocated.at(*it);
+	for(auto it = this->window.begin(); it != this->window.end(); it++)
+		if(*it != NULL)
+			*it = relocated.at(*it);
+	this->index_window();
+
+	for(auto it = old_points.begin(); it != old_points.end(); it++)
+		this->free_point(*it);
+	delete [] this->point_block;
+	this->point_block = new_block;
+	this->point_block_size = new_block_size;
+	this->nb_added_since_relocation = 0;
+}
+
+void Tree::relocate_points_if_needed()
+{
+	if(this->relocation_ratio <= 0)
+		return;
+	// The updates counter of the root is reset by its builds
+	if(this->root->get_updates_since_last_build() == 0
+		|| this->nb_added_since_relocation >= this->relocation_ratio * this->list_of_points.size())
+		this->relocate_points();
+}
+
+void Tree::set_relocation_ratio(float relocation_ratio)
+{
+	if(relocation_ratio > 0)
+		this->check_no_concurrent_writers("relocation of the points");
+	this->relocation_ratio = relocation_ratio;
+	if(relocation_ratio > 0)
+		this->relocate_points();
+}
+
+void Tree::publish()
+{
+	if(!this->use_concurrent_readers && this->shared_writer == NULL)
+		return;
+	this->root->flush();
+	bool is_changed = this->flat_tree.refresh(this->root);
+	if(this->use_concurrent_readers && (is_changed || !this->snapshots->is_published()))
+		this->snapshots->publish(this->flat_tree);
+	if(this->shared_writer != NULL && (is_changed || !this->shared_writer->is_published()))
+		this->shared_writer->publish(this->flat_tree);
 }
 
 std::string Tree::to_string()
 {
+	this->root->flush();
 	std::vector<std::string> vec_of_res = this->root->to_string();
 	return std::accumulate(vec_of_res.begin(), vec_of_res.end(), std::string(""));
 }
 
+void Tree::export_cpp(std::ostream& out, const std::string& function_name)
+{
+	this->root->flush();
+	out << "// Generated by Tree::export_cpp\n";
+	out << "#include <limits>\n\n";
+	out << "extern \"C\" bool " << function_name << "(const float* features)\n{\n";
+	this->root->export_cpp(out, 1);
+	out << "}\n";
+}
+
 void Tree::add_point(const float* features, bool value)
 {
 	Point* new_point = new Point(this->dimension, features, value);
@@ -55,8 +257,18 @@ void Tree::add_point(const float* features, bool value)
 
 void Tree::add_point(Point* to_add)
 {
+	if(this->config->use_concurrent_writers)
+	{
+		this->root->update_concurrently(to_add, true);
+		std::lock_guard<std::mutex> lock(*this->points_mutex);
+		this->list_of_points.insert(to_add);
+		return;
+	}
 	this->list_of_points.insert(to_add);
 	this->root->add_point(to_add);
+	this->nb_added_since_relocation++;
+	this->relocate_points_if_needed();
+	this->publish();
 }
 
 void Tree::add_point(Point to_add)
@@ -73,20 +285,358 @@ void Tree::delete_point(const float* features, bool value)
 
 void Tree::delete_point(Point to_delete)
 {
+	if(this->config->use_concurrent_writers)
+	{
+		Point* old_point;
+		{
+			std::lock_guard<std::mutex> lock(*this->points_mutex);
+			auto it_to_delete = this->list_of_points.find(&to_delete);
+			if(it_to_delete == this->list_of_points.end())
+				throw std::runtime_error("Error : Point does not exists");
+			old_point = *it_to_delete;
+			this->list_of_points.erase(it_to_delete);
+		}
+		this->root->update_concurrently(old_point, false);
+		// Other writers may still read the point, which is freed once they
+		// are disabled
+		std::lock_guard<std::mutex> lock(*this->points_mutex);
+		this->unlink_from_window(old_point);
+		this->retired_points.push_back(old_point);
+		return;
+	}
 	auto it_to_delete = this->list_of_points.find(&to_delete);
 	if(it_to_delete == this->list_of_points.end())
 		throw std::runtime_error("Error : Point does not exists");
 	this->root->delete_point(*it_to_delete);
-	delete *it_to_delete;
+	this->unlink_from_window(*it_to_delete);
+	this->retire_point(*it_to_delete);
 	this->list_of_points.erase(it_to_delete);
+	this->relocate_points_if_needed();
+	this->publish();
 }
 		
+void Tree::apply_batch(const std::vector<Point*>& to_add, const std::vector<Point>& to_delete)
+{
+	if(this->config->use_concurrent_writers)
+	{
+		for(auto it = to_add.begin(); it != to_add.end(); it++)
+			delete *it;
+		throw std::runtime_error("Error : batches can not be applied with concurrent writers");
+	}
+	std::multiset<Point*, point_ptr_compare> batch_points(to_add.begin(), to_add.end());
+	std::vector<Point*> cancelled;
+	std::vector<Point*> deleted;
+	for(auto it = to_delete.begin(); it != to_delete.end(); it++)
+	{
+		Point* pattern = const_cast<Point*>(&*it);
+		auto batch_it = batch_points.find(pattern);
+		if(batch_it != batch_points.end())
+		{
+			cancelled.push_back(*batch_it);
+			batch_points.erase(batch_it);
+			continue;
+		}
+		auto tree_it = this->list_of_points.find(pattern);
+		if(tree_it == this->list_of_points.end())
+		{
+			// Leave the tree as it was
+			this->list_of_points.insert(deleted.begin(), deleted.end());
+			for(auto add_it = to_add.begin(); add_it != to_add.end(); add_it++)
+				delete *add_it;
+			throw std::runtime_error("Error : Point does not exists");
+		}
+		deleted.push_back(*tree_it);
+		this->list_of_points.erase(tree_it);
+	}
+	for(auto it = cancelled.begin(); it != cancelled.end(); it++)
+		delete *it;
+
+	std::vector<std::pair<Point*, bool>> updates;
+	updates.reserve(batch_points.size() + deleted.size());
+	for(auto it = batch_points.begin(); it != batch_points.end(); it++)
+	{
+		this->list_of_points.insert(*it);
+		updates.push_back(std::make_pair(*it, true));
+	}
+	for(auto it = deleted.begin(); it != deleted.end(); it++)
+		updates.push_back(std::make_pair(*it, false));
+	if(updates.empty())
+		return;
+	this->root->apply_batch(updates);
+	for(auto it = deleted.begin(); it != deleted.end(); it++)
+	{
+		this->unlink_from_window(*it);
+		this->retire_point(*it);
+	}
+	this->nb_added_since_relocation += batch_points.size();
+	this->relocate_points_if_needed();
+	this->publish();
+}
+
+void Tree::set_window(const std::vector<Point*>& window_points)
+{
+	for(auto it = window_points.begin(); it != window_points.end(); it++)
+	{
+		auto range = this->list_of_points.equal_range(*it);
+		if(std::find(range.first, range.second, *it) == range.second)
+			throw std::runtime_error("Error : Point of the window is not in the tree");
+	}
+	this->window = window_points;
+	this->window_start = 0;
+	this->index_window();
+}
+
+void Tree::slide(Point* new_point)
+{
+	if(this->window.empty())
+	{
+		delete new_point;
+		throw std::runtime_error("Error : No sliding window has been started");
+	}
+	if(this->config->use_concurrent_writers)
+	{
+		delete new_point;
+		throw std::runtime_error("Error : the window can not slide with concurrent writers");
+	}
+	size_t oldest = this->window_start;
+	Point* old_point = this->window[oldest];
+	this->window_start = (oldest + 1) % this->window.size();
+	// The oldest point then stands for the new one, as the newest
+	if(old_point != NULL && *old_point == *new_point)
+	{
+		delete new_point;
+		return;
+	}
+	std::vector<std::pair<Point*, bool>> updates;
+	updates.push_back(std::make_pair(new_point, true));
+	// The points of the window deleted meanwhile are unlinked from it,
+	// hence the others are all in the tree
+	if(old_point != NULL)
+	{
+		auto range = this->list_of_points.equal_range(old_point);
+		this->list_of_points.erase(std::find(range.first, range.second, old_point));
+		this->window_positions.erase(old_point);
+		updates.push_back(std::make_pair(old_point, false));
+	}
+	this->list_of_points.insert(new_point);
+	this->root->apply_batch(updates);
+	if(old_point != NULL)
+		this->retire_point(old_point);
+	this->window[oldest] = new_point;
+	this->window_positions[new_point] = oldest;
+	this->nb_added_since_relocation++;
+	this->relocate_points_if_needed();
+	this->publish();
+}
+
 bool Tree::decision(const float* features)
 {
-	return this->root->decision(features);
+	if(this->use_concurrent_readers)
+		return this->snapshots->decision(features);
+	this->flat_tree.refresh(this->root);
+	return this->flat_tree.decision(features);
+}
+
+bool Tree::quick_decision(const float* features)
+{
+	this->flat_tree.refresh(this->root);
+	this->quick_scorer.refresh(this->flat_tree);
+	return this->quick_scorer.decision(this->flat_tree, features);
+}
+
+bool Tree::check_quick_decision(const float* features)
+{
+	bool quick_result = this->quick_decision(features);
+	return quick_result == this->root->decision(features);
+}
+
+void Tree::decision_batch(const float* rows, size_t nb_rows, bool* decisions)
+{
+	if(this->use_concurrent_readers)
+		this->snapshots->decision_batch(rows, nb_rows, false, decisions);
+	else
+	{
+		this->flat_tree.refresh(this->root);
+		this->flat_tree.decision_batch(rows, nb_rows, false, decisions);
+	}
+}
+
+void Tree::decision_batch_columns(const float* columns, size_t nb_rows, bool* decisions)
+{
+	if(this->use_concurrent_readers)
+		this->snapshots->decision_batch(columns, nb_rows, true, decisions);
+	else
+	{
+		this->flat_tree.refresh(this->root);
+		this->flat_tree.decision_batch(columns, nb_rows, true, decisions);
+	}
 }
 
 unsigned int Tree::get_training_error()
 {
+	this->root->flush();
 	return this->root->get_training_error();
 }
+
+void Tree::set_epsilon(float epsilon)
+{
+	this->config->epsilon = epsilon;
+	this->config->epsilon_max = std::max(this->config->epsilon_max, epsilon);
+	this->root->refresh_epsilon();
+}
+
+void Tree::set_epsilon_transmission(float epsilon_transmission)
+{
+	this->config->epsilon_transmission = epsilon_transmission;
+}
+
+void Tree::reconfigure(unsigned int max_height, unsigned int min_split_points, float min_split_gini)
+{
+	this->max_height = max_height;
+	this->config->min_split_points = min_split_points;
+	this->config->min_split_gini = min_split_gini;
+	this->root->reconfigure(max_height-1);
+	this->publish();
+}
+
+void Tree::flush()
+{
+	this->root->flush();
+	this->publish();
+}
+
+void Tree::set_lazy(bool is_lazy)
+{
+	if(is_lazy)
+	{
+		this->check_no_concurrent_writers("lazy rebuilds");
+		this->check_not_published("lazy rebuilds");
+	}
+	this->config->is_lazy = is_lazy;
+	if(!is_lazy)
+		this->root->flush();
+	this->publish();
+}
+
+void Tree::set_use_subset_splits(bool use_subset_splits)
+{
+	this->root->set_use_subset_splits(use_subset_splits);
+}
+
+void Tree::set_use_pruning(bool use_pruning)
+{
+	if(use_pruning)
+		this->check_no_concurrent_writers("pruning");
+	this->config->use_pruning = use_pruning;
+	this->root->refresh_pruning();
+	this->publish();
+}
+
+void Tree::set_concurrent_readers(bool use_concurrent_readers)
+{
+	if(use_concurrent_readers && (this->config->is_lazy || this->config->buffer_size > 0))
+		throw std::runtime_error("Error : concurrent readers can not be used with lazy rebuilds nor buffers");
+	if(use_concurrent_readers)
+		this->check_no_concurrent_writers("concurrent readers");
+	this->use_concurrent_readers = use_concurrent_readers;
+	if(use_concurrent_readers && this->snapshots == NULL)
+		this->snapshots = new SnapshotPublisher();
+	this->publish();
+}
+
+void Tree::set_concurrent_writers(bool use_concurrent_writers)
+{
+	if(use_concurrent_writers && (this->config->is_lazy || this->config->buffer_size > 0
+		|| this->config->rebuild_budget > 0 || this->config->async_min_size > 0 || this->config->nb_pending_rebuilds > 0
+		|| this->config->use_pruning || this->config->use_tombstones || !this->root->get_rebuild_policy().is_local()
+		|| this->use_concurrent_readers || this->shared_writer != NULL || this->relocation_ratio > 0))
+		throw std::runtime_error("Error : concurrent writers can not be used with lazy rebuilds, buffers, pending rebuilds, pruning, tombstones, rebuild policies reading the children, concurrent readers, shared memory nor relocation");
+	if(use_concurrent_writers && this->points_mutex == NULL)
+		this->points_mutex = new std::mutex();
+	this->config->use_concurrent_writers = use_concurrent_writers;
+	this->root->refresh_writer_locks();
+	if(!use_concurrent_writers)
+		this->free_retired_points();
+}
+
+void Tree::set_shared_memory(const std::string& name, uint32_t node_capacity)
+{
+	if(!name.empty() && (this->config->is_lazy || this->config->buffer_size > 0))
+		throw std::runtime_error("Error : shared memory can not be used with lazy rebuilds nor buffers");
+	if(!name.empty())
+		this->check_no_concurrent_writers("shared memory");
+	delete this->shared_writer;
+	this->shared_writer = NULL;
+	if(name.empty())
+		return;
+	if(node_capacity == 0 && this->max_height >= 32)
+		throw std::runtime_error("Error : the capacity of the shared memory should be given for trees of height 32 or more");
+	if(node_capacity == 0)
+		node_capacity = (1u << this->max_height) - 1;
+	// At most one split out of two nodes
+	this->shared_writer = new SharedTreeWriter(name, this->dimension, node_capacity, node_capacity / 2);
+	this->publish();
+}
+
+void Tree::set_use_tombstones(bool use_tombstones)
+{
+	if(use_tombstones)
+		this->check_no_concurrent_writers("tombstones");
+	this->config->use_tombstones = use_tombstones;
+}
+
+void Tree::set_buffer_size(unsigned int buffer_size)
+{
+	if(buffer_size > 0)
+	{
+		this->check_no_concurrent_writers("buffers");
+		this->check_not_published("buffers");
+	}
+	this->config->buffer_size = buffer_size;
+	this->root->fit_buffers();
+	this->publish();
+}
+
+
+void Tree::set_use_certificate(bool use_certificate)
+{
+	this->config->use_certificate = use_certificate;
+}
+
+void Tree::set_rebuild_policy(const RebuildPolicy& rebuild_policy)
+{
+	if(!rebuild_policy.is_local())
+		this->check_no_concurrent_writers("rebuild policies reading the children");
+	this->root->set_rebuild_policy(rebuild_policy);
+}
+
+void Tree::set_rebuild_budget(unsigned long rebuild_budget)
+{
+	if(rebuild_budget > 0)
+		this->check_no_concurrent_writers("pending rebuilds");
+	this->config->rebuild_budget = rebuild_budget;
+}
+
+void Tree::set_async_min_size(unsigned int async_min_size)
+{
+	if(async_min_size > 0)
+		this->check_no_concurrent_writers("background rebuilds");
+	this->config->async_min_size = async_min_size;
+}
+
+void Tree::set_max_pending_lag(float max_pending_lag)
+{
+	this->config->max_pending_lag = max_pending_lag;
+}
+
+void Tree::set_parallel_depth(unsigned int parallel_depth)
+{
+	this->config->parallel_depth = parallel_depth;
+}
+
+void Tree::set_adaptive_epsilon(double update_time_budget, float epsilon_max)
+{
+	this->config->update_time_budget = update_time_budget / (this->max_height + 1);
+	this->config->epsilon_max = std::max(epsilon_max, this->config->epsilon);
+	this->root->refresh_epsilon();
+}
@@ -7,7 +7,14 @@
 
 #include <set>
 #include <vector>
+#include <unordered_map>
+#include <mutex>
 #include "Vertex.h"
+#include "TreeConfig.h"
+#include "FlatTree.h"
+#include "QuickScorer.h"
+#include "SnapshotPublisher.h"
+#include "SharedTreeWriter.h"
 #include "../PointSet/Point.h"
 #include "../PointSet/PointSet.h"
 
@@ -38,6 +45,36 @@ class Tree {
 		/// The root vertex of the tree
 		Vertex* root;
 
+		/// Types of the features of the points
+		std::vector<FeatureType> features_types;
+
+		/// Contiguous copy of the vertices, used for decisions
+		FlatTree flat_tree;
+
+		/// Bitvector conditions made from flat_tree, used by Tree#quick_decision
+		QuickScorer quick_scorer;
+
+		/**
+		 * Copies of flat_tree read by Tree#decision with concurrent readers,
+		 * or NULL if they have never been enabled
+		 */
+		SnapshotPublisher* snapshots;
+
+		/**
+		 * Indicates whether decisions are made on the copies published in
+		 * {@link #snapshots snapshots}
+		 *
+		 * @see Tree#set_concurrent_readers
+		 */
+		bool use_concurrent_readers;
+
+		/**
+		 * Publisher of the tree in shared memory, or NULL if it is not shared
+		 *
+		 * @see Tree#set_shared_memory
+		 */
+		SharedTreeWriter* shared_writer;
+
 		/// Mutliset of all the points contained in the tree
 		std::multiset<Point*, point_ptr_compare> list_of_points;
 
@@ -47,29 +84,147 @@ class Tree {
 		/// Maximal height of the tree
 		size_t max_height;
 
-		/// Epsilon parameter, used for deciding when to rebuild a vertex
-		float epsilon;
+		/**
+		 * Settings of the tree, read by all its vertices, and memory of the
+		 * vertices
+		 *
+		 * @note This is owned by the tree, and freed after the root
+		 */
+		TreeConfig* config;
+
+		/**
+		 * Points deleted from the tree that could not be freed yet
+		 *
+		 * A deleted point may still be referenced by a pending rebuild, by
+		 * the buffer of a vertex or by a pointset in which it is only marked
+		 * as deleted, hence it is kept here until none of those remain. The
+		 * points deleted by concurrent writers are kept until they are
+		 * disabled.
+		 *
+		 * @note The points are owned by the tree
+		 */
+		std::vector<Point*> retired_points;
+
+		/**
+		 * Protects {@link #list_of_points list_of_points} and
+		 * {@link #retired_points retired_points} with concurrent writers, or
+		 * NULL if they have never been enabled
+		 *
+		 * @see Tree#set_concurrent_writers
+		 */
+		std::mutex* points_mutex;
+
+		/**
+		 * Memory of the points laid out by Tree#relocate_points, or NULL
+		 *
+		 * Each point is followed by its features, and the points of each
+		 * leaf are contiguous, the leaves being in tree order.
+		 */
+		char* point_block;
+
+		/// Size of {@link #point_block point_block}, in bytes
+		size_t point_block_size;
+
+		/**
+		 * Ratio of the points added since the last relocation to the points
+		 * of the tree, from which the points are relocated again
+		 *
+		 * If 0, the points are not relocated automatically.
+		 *
+		 * @see Tree#set_relocation_ratio
+		 */
+		float relocation_ratio;
+
+		/// Number of points added since the last relocation
+		unsigned long nb_added_since_relocation;
+
+		/**
+		 * Ring buffer of the points of the sliding window, or empty if no
+		 * window has been started
+		 *
+		 * The points are the ones of the tree, the oldest being at
+		 * {@link #window_start window_start}. A point deleted otherwise than
+		 * by Tree#slide leaves a NULL slot.
+		 *
+		 * @see Tree#slide
+		 */
+		std::vector<Point*> window;
+
+		/// Position of the oldest point in {@link #window window}
+		size_t window_start;
 
-		/// Min number of points that a Vertex should contain to not be a leaf
-		unsigned int min_split_points;
+		/// Position of each point of the window in {@link #window window}
+		std::unordered_map<Point*, size_t> window_positions;
 
-		/// Min value that a Vertex should match to not be a leaf
-		float min_split_gini;
+		/**
+		 * Free memory of a point of the tree
+		 *
+		 * @param old_point The point to free, allocated on its own or in
+		 * 	{@link #point_block point_block}
+		 */
+		void free_point(Point* old_point);
+
+		/**
+		 * Relocate the points if the root has just been rebuilt, or if enough
+		 * points have been added since the last relocation
+		 *
+		 * @see Tree#set_relocation_ratio
+		 */
+		void relocate_points_if_needed();
 
 		/**
-		 * Epsilon value to use when figuring out which vertex to recompute
+		 * Free memory of a point deleted from the tree, as soon as possible
 		 *
-		 * Epsilon is used twice in the algorithm : once to decide whether the
-		 * vertex should be recalculated, and a second time when it has been
-		 * decided that the vertex should be recalculated, which parent of the
-		 * vertex or the vertex itself should be recalculate (see the paper for
-		 * more details). This parameter allow to have a different value of
-		 * epsilon for the second purpose.
+		 * @param old_point The point deleted from the tree
+		 * @see Tree#retired_points
+		 */
+		void retire_point(Point* old_point);
+
+		/// Free memory of the retired points, if none may be referenced
+		void free_retired_points();
+
+		/**
+		 * Empty the slot of a point in the sliding window, if any
 		 *
-		 * @note In most of the cases, this is expected to be equal to
-		 *		1, although the implementation is able to handle different value
+		 * @param old_point The point deleted from the tree
 		 */
-		float epsilon_transmission;
+		void unlink_from_window(Point* old_point);
+
+		/// Refresh {@link #window_positions window_positions} from the window
+		void index_window();
+
+		/**
+		 * Throw if concurrent writers are enabled, for a setting that would
+		 * update or read the tree beyond the path of a point
+		 *
+		 * @param setting Name of the setting, for the error message
+		 * @throw std::runtime_error When concurrent writers are enabled
+		 * @see Tree#set_concurrent_writers
+		 */
+		void check_no_concurrent_writers(const std::string& setting) const;
+
+		/**
+		 * Throw if the tree is published to concurrent readers or to shared
+		 * memory, for a setting that defers work that each publication would
+		 * have to complete
+		 *
+		 * @param setting Name of the setting, for the error message
+		 * @throw std::runtime_error When the tree is published
+		 * @see Tree#publish
+		 */
+		void check_not_published(const std::string& setting) const;
+
+		/**
+		 * Publish the changes of the tree to the concurrent readers and to
+		 * the shared memory, if any
+		 *
+		 * The dirty vertices and the buffers are brought up to date first,
+		 * so that readers never read the vertices.
+		 *
+		 * @see Tree#set_concurrent_readers
+		 * @see Tree#set_shared_memory
+		 */
+		void publish();
 	public:
 		/**
 		 * Main constructor of Tree
@@ -129,6 +284,8 @@ class Tree {
 		/**
 		 * Create string representing the tree
 		 *
+		 * The dirty vertices are built first.
+		 *
 		 * @see Vertex#to_string
 		 */
 		std::string to_string();
@@ -152,6 +309,7 @@ class Tree {
 		 * matched
 		 *
 		 * @param to_add The point to add, the Tree takes ownership of it
+		 * @warning The point may be moved by Tree#relocate_points
 		 */
 		void add_point(Point* to_add);
 
@@ -193,20 +351,479 @@ class Tree {
 		 */
 		void delete_point(Point to_delete);
 
+		/**
+		 * Add and delete a batch of points
+		 *
+		 * The result is the one of adding all the points of @p to_add and
+		 * then deleting the points of @p to_delete, but the batch goes down
+		 * the tree once: each vertex updates its pointset with its part of
+		 * the batch and checks the rebuild rule once. A point deleted in the
+		 * same batch as it is added never reaches the tree.
+		 *
+		 * @param to_add The points to add, the Tree takes ownership of them
+		 * @param to_delete Points with same features and value as the ones to
+		 * 	remove, each matching a point of the tree or of @p to_add
+		 * @throw std::runtime_error When a point to delete has no match, or
+		 * 	with concurrent writers. The tree is then left unchanged, and the
+		 * 	points of @p to_add are freed
+		 */
+		void apply_batch(const std::vector<Point*>& to_add, const std::vector<Point>& to_delete);
+
+		/**
+		 * Start a sliding window on the points of the tree
+		 *
+		 * The size of the window is the number of points given, and stays
+		 * the same at each Tree#slide.
+		 *
+		 * A point of the window deleted by Tree#delete_point or
+		 * Tree#apply_batch leaves an empty slot, which the next Tree#slide
+		 * reaching it fills without deleting anything.
+		 *
+		 * @param window_points Points of the tree, oldest first
+		 * @throw std::runtime_error When a point is not one of the tree
+		 */
+		void set_window(const std::vector<Point*>& window_points);
+
+		/**
+		 * Replace the oldest point of the sliding window by a new one
+		 *
+		 * The result is the one of deleting the oldest point and then adding
+		 * the new one, but both updates go down the tree together as a batch
+		 * of Tree#apply_batch: they are split only where their paths
+		 * diverge, and each vertex checks the rebuild rule once. If both
+		 * points are equal, the tree is left unchanged. If the oldest point
+		 * has already been deleted, the new point is only added.
+		 *
+		 * @param new_point The point to add, the Tree takes ownership of it
+		 * @throw std::runtime_error When no window has been started, or with
+		 * 	concurrent writers. The tree is then left unchanged, and
+		 * 	@p new_point is freed
+		 * @see Tree#set_window
+		 */
+		void slide(Point* new_point);
+
 		/**
 		 * Get the decision of the tree for given features
 		 *
+		 * The decision is made on a FlatTree, of which only the vertices
+		 * updated or rebuilt since the last decision are refreshed. With
+		 * concurrent readers, it is made on the last published copy instead,
+		 * and can be called by any thread.
+		 *
 		 * @param features Features for which a decision has to be made. No
 		 *	ownership is taken.
 		 */
 		bool decision(const float* features);
 
+		/**
+		 * Get the decisions of the tree for several points
+		 *
+		 * This gives the same decisions as Tree#decision for each point, but
+		 * the points go down the tree together, which hides most of the
+		 * memory latency of a walk. With concurrent readers, this can be
+		 * called by any thread, as Tree#decision.
+		 *
+		 * @param rows Features of the points, the features of each point
+		 * 	being contiguous. No ownership is taken
+		 * @param nb_rows Number of points
+		 * @param decisions Out argument, array of at least @p nb_rows
+		 * 	elements receiving the decisions
+		 * @see FlatTree#decision_batch
+		 */
+		void decision_batch(const float* rows, size_t nb_rows, bool* decisions);
+
+		/**
+		 * Get the decisions of the tree for points stored by feature
+		 *
+		 * This is Tree#decision_batch for features stored in column-major
+		 * order, the value of feature f for point i being
+		 * columns[f*nb_rows + i]. With concurrent readers, this can be called
+		 * by any thread, as Tree#decision.
+		 *
+		 * @param columns Features of the points, the values of each feature
+		 * 	being contiguous. No ownership is taken
+		 * @param nb_rows Number of points
+		 * @param decisions Out argument, array of at least @p nb_rows
+		 * 	elements receiving the decisions
+		 */
+		void decision_batch_columns(const float* columns, size_t nb_rows, bool* decisions);
+
+		/**
+		 * Get the decision of the tree for given features, by bitvectors
+		 *
+		 * This gives the same decision as Tree#decision, with the QuickScorer
+		 * algorithm, whose conditions are only made again after the splits of
+		 * the tree changed.
+		 *
+		 * @param features Features for which a decision has to be made. No
+		 *	ownership is taken.
+		 * @see QuickScorer
+		 */
+		bool quick_decision(const float* features);
+
+		/**
+		 * Check that Tree#quick_decision agrees with the vertices
+		 *
+		 * @param features Features for which a decision has to be made. No
+		 *	ownership is taken.
+		 * @return true if Tree#quick_decision gives the same decision as
+		 * 	Vertex#decision on the root
+		 */
+		bool check_quick_decision(const float* features);
+
+		/**
+		 * Write the decision function of the tree as C++ code
+		 *
+		 * The code is a self-contained function, with C linkage, taking the
+		 * features of a point and returning the same decision as
+		 * Tree#decision, made of nested if over the features. It can be
+		 * compiled and loaded by CompiledTree. The dirty vertices are built
+		 * first.
+		 *
+		 * @param out The stream to write the code into
+		 * @param function_name The name of the function
+		 */
+		void export_cpp(std::ostream& out, const std::string& function_name = "tree_decision");
+
 		/**
 		 * Get the training error
 		 *
 		 * This is the absolute number of points in the Tree that would not be 
-		 * associated with the right decision if evaluated.
+		 * associated with the right decision if evaluated. The dirty vertices
+		 * are built first, otherwise this is O(1).
 		 */
 		unsigned int get_training_error();
+
+		/**
+		 * Build all the vertices whose rebuild has been deferred
+		 *
+		 * @see Tree#set_lazy
+		 */
+		void flush();
+
+		/**
+		 * Enable or disable lazy rebuilds
+		 *
+		 * When enabled, a vertex meeting the conditions for being rebuilt is
+		 * only marked dirty, and stops propagating updates to its children.
+		 * It is built when a decision goes through it or on Tree#flush, hence
+		 * a burst of updates leads to a single build. When disabled, the dirty
+		 * vertices are built, as by Tree#flush.
+		 *
+		 * @param is_lazy True to defer the rebuilds until the vertices are read
+		 * @throw std::runtime_error When enabled with concurrent writers,
+		 * 	concurrent readers or shared memory
+		 */
+		void set_lazy(bool is_lazy);
+
+		/**
+		 * Enable or disable subset splits of classified features
+		 *
+		 * When enabled, a classified feature can be split between any subset
+		 * of its categories and the rest, instead of one category and the
+		 * rest, which gives shallower trees for features with many
+		 * categories. The best subset is found by sorting the categories by
+		 * proportion of positive points. This applies from the next rebuilds.
+		 *
+		 * @param use_subset_splits True to split classified features by
+		 * 	subsets of categories
+		 * @see PointSet#use_subset_splits
+		 */
+		void set_use_subset_splits(bool use_subset_splits);
+
+		/**
+		 * Enable or disable the pruning of uniform subtrees for decisions
+		 *
+		 * When enabled, each vertex keeps track, on the update path, of
+		 * whether all the leaves below it give the same decision. Decisions
+		 * stop at such vertices, whose subtree is kept for its statistics and
+		 * for later rebuilds. Decisions are unchanged.
+		 *
+		 * @param use_pruning True to stop decisions at uniform vertices
+		 * @throw std::runtime_error When enabled with concurrent writers
+		 */
+		void set_use_pruning(bool use_pruning);
+
+		/**
+		 * Enable or disable tombstone deletions
+		 *
+		 * When enabled, deleting a point only updates the counters of the
+		 * pointsets on its path, which avoids searching for it in each of
+		 * them. The point is physically removed from a pointset on the next
+		 * build of its vertex, and from all of them by Tree#compact, which is
+		 * made automatically once the deleted points outnumber the points of
+		 * the tree.
+		 *
+		 * @param use_tombstones True to only mark the deleted points
+		 * @throw std::runtime_error When enabled with concurrent writers
+		 */
+		void set_use_tombstones(bool use_tombstones);
+
+		/**
+		 * Remove the points marked as deleted from all the vertices, and free
+		 * the retired points when possible
+		 */
+		void compact();
+
+		/**
+		 * Lay the points out in memory by leaf
+		 *
+		 * The points are copied in a single block, each followed by its
+		 * features, the points of each leaf being contiguous and the leaves
+		 * being in tree order. The scans of a PointSet, which go through its
+		 * points by address, then read memory sequentially. The dirty
+		 * vertices are laid out as leaves, and the points not in a leaf yet
+		 * come last. The state of the tree is not changed otherwise.
+		 *
+		 * Nothing is done while a rebuild is pending, as the shadow subtrees
+		 * and the snapshots of the background builds refer to the points.
+		 *
+		 * @warning The points given to Tree#add_point(Point*) are moved
+		 */
+		void relocate_points();
+
+		/**
+		 * Enable or disable the automatic relocation of the points
+		 *
+		 * When enabled, the points are relocated at once, then after each
+		 * rebuild of the root and once the points added since the last
+		 * relocation reach @p relocation_ratio times the number of points of
+		 * the tree. Points added one by one are otherwise scattered in
+		 * memory.
+		 *
+		 * @param relocation_ratio Ratio of added points from which the points
+		 * 	are relocated. If 0, points are only relocated by
+		 * 	Tree#relocate_points
+		 * @throw std::runtime_error When enabled with concurrent writers
+		 * @see Tree#relocate_points
+		 */
+		void set_relocation_ratio(float relocation_ratio);
+
+		/**
+		 * Set the number of updates buffered by each vertex
+		 *
+		 * When not 0, each internal vertex updates its pointset at once but
+		 * buffers the updates of its children, and pushes them in bulk, grouped
+		 * by child, once the buffer is full or before a decision or a rebuild.
+		 * An update followed by the opposite update of the same point is
+		 * cancelled while buffered.
+		 *
+		 * @param buffer_size Maximal number of updates buffered by a vertex.
+		 * 	If 0, updates are propagated at once
+		 * @throw std::runtime_error When enabled with concurrent writers,
+		 * 	concurrent readers or shared memory
+		 */
+		void set_buffer_size(unsigned int buffer_size);
+
+		/**
+		 * Enable or disable decisions by concurrent reader threads
+		 *
+		 * When enabled, a copy of the FlatTree of the tree is published after
+		 * each change, and Tree#decision, Tree#decision_batch and
+		 * Tree#decision_batch_columns read the last published copy without
+		 * taking a lock. They can then be called by any number of threads
+		 * while a single writer thread updates the tree. The copies are reused
+		 * once no reader may still read them (see SnapshotPublisher).
+		 *
+		 * @param use_concurrent_readers True to make decisions on the
+		 * 	published copies
+		 * @throw std::runtime_error When enabled with concurrent writers,
+		 * 	lazy rebuilds or buffers, as each publication would bring the
+		 * 	dirty vertices and the buffers up to date
+		 * @note All the other methods should only be called by the writer
+		 */
+		void set_concurrent_readers(bool use_concurrent_readers);
+
+		/**
+		 * Enable or disable updates by concurrent writer threads
+		 *
+		 * When enabled, Tree#add_point and Tree#delete_point can be called by
+		 * any number of threads at once. Each vertex gets a lock, held while
+		 * the vertex is updated, hence updates along different paths proceed
+		 * in parallel below the vertices they share, and a rebuild only
+		 * waits for the updates in progress in the rebuilt subtree (see
+		 * Vertex#update_concurrently).
+		 *
+		 * A point added is only found by Tree#delete_point once its addition
+		 * is complete. The points deleted meanwhile are only freed once
+		 * concurrent writers are disabled.
+		 *
+		 * @param use_concurrent_writers True to allow concurrent updates
+		 * @throw std::runtime_error When enabled with lazy rebuilds, buffers,
+		 * 	pending rebuilds, pruning, tombstones, a rebuild policy that is not
+		 * 	local, concurrent readers, shared memory or relocation of the
+		 * 	points, which all update or read the tree beyond the path of a
+		 * 	point. Enabling them, Tree#apply_batch
+		 * 	and Tree#slide throw in turn while concurrent writers are enabled
+		 * @note All the other methods, including the settings, should only be
+		 * 	called while no update is in progress
+		 */
+		void set_concurrent_writers(bool use_concurrent_writers);
+
+		/**
+		 * Publish the tree in POSIX shared memory, for other processes
+		 *
+		 * The nodes of the tree are copied in a segment after each change,
+		 * and can be read by TreeReader instances of any process mapping it.
+		 *
+		 * @param name Name of the POSIX shared memory object, starting with
+		 * 	'/'. It is removed when the tree is destroyed or stops being
+		 * 	shared. If empty, the tree stops being shared
+		 * @param node_capacity Maximal number of nodes of the tree. If 0, the
+		 * 	maximal number of vertices of a tree of the maximal height
+		 * @throw std::runtime_error When the segment could not be created, or
+		 * 	when enabled with concurrent writers, lazy rebuilds or buffers
+		 * @see SharedTreeWriter
+		 * @note If the tree is reconfigured to a larger height than its
+		 * 	capacity allows, the updates throw once it outgrows the segment
+		 */
+		void set_shared_memory(const std::string& name, uint32_t node_capacity = 0);
+
+		/**
+		 * Change the epsilon of the tree in place
+		 *
+		 * Pending rebuilds use the new value from their next steps.
+		 *
+		 * @param epsilon The new epsilon parameter
+		 * @see Vertex#refresh_epsilon
+		 */
+		void set_epsilon(float epsilon);
+
+		/**
+		 * Change the epsilon_transmission of the tree in place
+		 *
+		 * @param epsilon_transmission The new epsilon_transmission parameter
+		 */
+		void set_epsilon_transmission(float epsilon_transmission);
+
+		/**
+		 * Change the parameters deciding the shape of the tree in place
+		 *
+		 * Only the vertices that should become leaves, or the leaves that
+		 * should now be split, are rebuilt.
+		 *
+		 * @param max_height The new maximal height of the decision tree
+		 * @param min_split_points The new minimal number of points a Vertex
+		 * 	should contain to be split
+		 * @param min_split_gini The new minimal gini value a Vertex should
+		 * 	have to be split
+		 * @see Vertex#reconfigure
+		 */
+		void reconfigure(unsigned int max_height, unsigned int min_split_points, float min_split_gini);
+
+		/**
+		 * Enable or disable certificate-based rebuild skipping
+		 *
+		 * When enabled, each vertex delays its rebuild while the outcome of its
+		 * last build is certified to be unchanged, and is never rebuilt earlier
+		 * than the epsilon rule alone would do.
+		 *
+		 * @param use_certificate True to enable rebuild skipping
+		 * @see TreeConfig#use_certificate
+		 */
+		void set_use_certificate(bool use_certificate);
+
+		/**
+		 * Set the policy deciding when to rebuild vertices
+		 *
+		 * Each vertex of the tree gets its own copy of the policy. By default,
+		 * the epsilon rule of the algorithm is used.
+		 *
+		 * @param rebuild_policy The policy to copy. No ownership is taken
+		 * @throw std::runtime_error When the policy reads the children of the
+		 * 	vertices, as DriftRebuildPolicy does, with concurrent writers
+		 * @see RebuildPolicy#is_local
+		 * @see EpsilonRebuildPolicy
+		 * @see DriftRebuildPolicy
+		 */
+		void set_rebuild_policy(const RebuildPolicy& rebuild_policy);
+
+		/**
+		 * Set the number of point-operations spent per update on rebuilds
+		 *
+		 * If not 0, a rebuild is built in a shadow subtree in steps of at most
+		 * @p rebuild_budget point-operations per subsequent update going
+		 * through the rebuilt vertex, while the current subtree keeps making
+		 * decisions. The shadow subtree is swapped in once complete. This
+		 * bounds the cost of an update instead of only the amortized cost.
+		 *
+		 * @param rebuild_budget Number of point-operations allowed per update
+		 * 	on each pending rebuild. If 0, rebuilds are made at once
+		 * @throw std::runtime_error When enabled with concurrent writers
+		 * @note A feature of a vertex is always evaluated entirely, hence a
+		 * 	step may exceed the budget by the size of the vertex
+		 * @see TreeConfig#rebuild_budget
+		 */
+		void set_rebuild_budget(unsigned long rebuild_budget);
+
+		/**
+		 * Set the minimal size of a vertex for rebuilding it in background
+		 *
+		 * If not 0, the rebuild of a vertex containing at least
+		 * @p async_min_size points is made by a background thread while the
+		 * current subtree keeps being updated and making decisions. The
+		 * updates received in the meantime are replayed onto the new subtree,
+		 * which is then swapped in by the next update going through the
+		 * vertex.
+		 *
+		 * @param async_min_size Minimal number of points of a vertex for its
+		 * 	rebuilds to be made in background. If 0, no rebuild is made in
+		 * 	background
+		 * @throw std::runtime_error When enabled with concurrent writers
+		 * @note The pointset of the vertex is copied by the calling thread
+		 * @see TreeConfig#async_min_size
+		 */
+		void set_async_min_size(unsigned int async_min_size);
+
+		/**
+		 * Set the maximal lag of the pending rebuilds
+		 *
+		 * While a rebuild is pending, the vertices of the current subtree are
+		 * not rebuilt. Once the vertex has received more than
+		 * @p max_pending_lag times its rebuild threshold updates since its
+		 * rebuild started, the rebuild is completed at once by the next
+		 * update, which waits for the background thread if needed.
+		 *
+		 * @param max_pending_lag Factor of epsilon times the size of the
+		 * 	vertex at building. If 0, the lag is not bounded
+		 * @see TreeConfig#max_pending_lag
+		 */
+		void set_max_pending_lag(float max_pending_lag);
+
+		/**
+		 * Set the depth down to which batches are applied by several threads
+		 *
+		 * If not 0, Tree#apply_batch updates the 2^@p parallel_depth subtrees
+		 * at this depth in parallel, each on its own thread. The vertices
+		 * above are updated by the calling thread, which also rebuilds them
+		 * or the roots of these subtrees as needed once their updates are
+		 * done.
+		 *
+		 * @param parallel_depth Depth of the subtrees updated in parallel. If
+		 * 	0, batches are applied by the calling thread only
+		 * @note This has no effect with buffers, which apply their updates
+		 * 	one by one
+		 * @see TreeConfig#parallel_depth
+		 */
+		void set_parallel_depth(unsigned int parallel_depth);
+
+		/**
+		 * Enable or disable the tuning of epsilon by rebuild time
+		 *
+		 * Each vertex measures the time of its builds and the share of the
+		 * updates going through it, and tunes the epsilon of its rebuild rule
+		 * so that its rebuilds stay within its share of the budget. Vertices
+		 * that are both costly to build and frequently updated hence get
+		 * rebuilt less often, whereas cheap vertices keep the epsilon of the
+		 * tree.
+		 *
+		 * @param update_time_budget Rebuild time allowed per update, in ms,
+		 * 	shared evenly between the levels of the tree. If 0, epsilon is not
+		 * 	tuned
+		 * @param epsilon_max Upper bound of the tuned epsilon. The lower bound
+		 * 	is the epsilon of the tree
+		 * @see TreeConfig#update_time_budget
+		 */
+		void set_adaptive_epsilon(double update_time_budget, float epsilon_max);
 };
 #endif // TREE_H_INCLUDED
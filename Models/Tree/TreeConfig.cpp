@@ -0,0 +1,51 @@
+#include "TreeConfig.h"
+
+#include <algorithm>
+
+TreeConfig::TreeConfig(float epsilon, float epsilon_transmission, unsigned int min_split_points, float min_split_gini) :
+	epsilon(epsilon),
+	epsilon_transmission(epsilon_transmission),
+	min_split_points(min_split_points),
+	min_split_gini(min_split_gini),
+	use_certificate(false),
+	rebuild_budget(0),
+	async_min_size(0),
+	max_pending_lag(1),
+	is_lazy(false),
+	use_pruning(false),
+	use_tombstones(false),
+	buffer_size(0),
+	update_time_budget(0),
+	epsilon_max(epsilon),
+	parallel_depth(0),
+	use_concurrent_writers(false),
+	nb_root_updates(0),
+	nb_tombstones(0),
+	nb_pending_rebuilds(0),
+	nb_background_builds(0),
+	nb_buffered_deletions(0)
+{}
+
+TreeConfig::TreeConfig(const TreeConfig& source, float epsilon, float epsilon_transmission) :
+	epsilon(epsilon),
+	epsilon_transmission(epsilon_transmission),
+	min_split_points(source.min_split_points),
+	min_split_gini(source.min_split_gini),
+	use_certificate(source.use_certificate),
+	rebuild_budget(source.rebuild_budget),
+	async_min_size(source.async_min_size),
+	max_pending_lag(source.max_pending_lag),
+	is_lazy(source.is_lazy),
+	use_pruning(source.use_pruning),
+	use_tombstones(source.use_tombstones),
+	buffer_size(source.buffer_size),
+	update_time_budget(source.update_time_budget),
+	epsilon_max(std::max(epsilon, source.epsilon_max)),
+	parallel_depth(source.parallel_depth),
+	use_concurrent_writers(source.use_concurrent_writers),
+	nb_root_updates(0),
+	nb_tombstones(0),
+	nb_pending_rebuilds(0),
+	nb_background_builds(0),
+	nb_buffered_deletions(0)
+{}
@@ -0,0 +1,244 @@
+/**
+ * @file TreeConfig.h
+ * Definition of struct TreeConfig
+ */
+#ifndef TREECONFIG_H_INCLUDED
+#define TREECONFIG_H_INCLUDED
+
+#include <atomic>
+#include "VertexArena.h"
+
+/**
+ * Settings shared by all the vertices of a tree
+ *
+ * Each vertex references the TreeConfig of its tree instead of holding a
+ * copy of the settings, including the vertices of the shadow subtrees of
+ * pending rebuilds, which hence always use the current settings. It also
+ * holds the VertexArena the vertices are allocated from.
+ *
+ * The TreeConfig is owned by the Tree, and outlives all its vertices.
+ *
+ * @note The settings are only written by the thread updating the tree, and
+ * 	read by background builds, as they were when copied in each vertex
+ */
+struct TreeConfig {
+	/**
+	 * Parameter of the algorithm, used for deciding when to rebuild
+	 *
+	 * Higher epsilon value leads to more frequent rebuild and hence more
+	 * precise predictions, but also higher computation time.
+	 *
+	 * If epsilon=0, the whole tree will be rebuild at each update.
+	 */
+	float epsilon;
+
+	/**
+	 * Epsilon value to use when figuring out which vertex to recompute
+	 *
+	 * Epsilon is used twice in the algorithm : once to decide whether the
+	 * vertex should be recalculated, and a second time when it has been
+	 * decided that the vertex should be recalculated, which parent of the
+	 * vertex or the vertex itself should be recalculate (see the paper for
+	 * more details). This parameter allow to have a different value of
+	 * epsilon for the second purpose.
+	 *
+	 * @note In most of the cases, this is expected to be equal to
+	 *		1, although the implementation is able to handle different value
+	 */
+	float epsilon_transmission;
+
+	/// Minimal number of points in the pointset to allow splitting
+	unsigned int min_split_points;
+
+	/// Minimal gini value of the pointset to allow splitting
+	float min_split_gini;
+
+	/**
+	 * Indicates whether Vertex#certified_updates can delay rebuilds
+	 *
+	 * When true, a vertex is rebuilt only when both the epsilon rule and
+	 * the certificate allow it, so never earlier than the epsilon rule
+	 * alone would.
+	 */
+	bool use_certificate;
+
+	/**
+	 * Maximal number of point-operations spent on a pending rebuild per
+	 * update
+	 *
+	 * If 0, rebuilds are made at once. Else, a rebuild of a vertex is made
+	 * in a shadow subtree, a few steps at each update going through the
+	 * vertex, and swapped in when complete. In the meantime, the current
+	 * subtree keeps being updated and making decisions.
+	 */
+	unsigned long rebuild_budget;
+
+	/**
+	 * Minimal size of the pointset for a rebuild to be made in background
+	 *
+	 * If not 0, the rebuild of a vertex containing at least this number of
+	 * points is made by a background thread, on a snapshot of the
+	 * pointset. The current subtree keeps being updated and making
+	 * decisions, and the new subtree is swapped in by the first update
+	 * going through the vertex once the background build is complete.
+	 */
+	unsigned int async_min_size;
+
+	/**
+	 * Maximal lag of a pending rebuild, relative to its rebuild threshold
+	 *
+	 * If not 0, once a vertex has received more than this factor times
+	 * epsilon times its size at building updates since its pending rebuild
+	 * started, the rebuild is completed by the next update going through
+	 * the vertex, waiting for the background thread if needed. This bounds
+	 * the staleness of the current subtree, whose vertices are not
+	 * rebuilt in the meantime.
+	 */
+	float max_pending_lag;
+
+	/**
+	 * Indicates whether rebuilds are deferred until the vertex is read
+	 *
+	 * When true, a rebuild only marks the vertex as dirty, and the build is
+	 * made by the first decision going through it or by Vertex#flush.
+	 */
+	bool is_lazy;
+
+	/**
+	 * Indicates whether decisions can stop at uniform vertices
+	 *
+	 * When true, a decision going through a vertex whose leaves all give
+	 * the same decision returns it at once. The subtree is kept, for its
+	 * statistics and for being updated.
+	 */
+	bool use_pruning;
+
+	/**
+	 * Indicates whether deletions only mark the points as deleted
+	 *
+	 * When true, a point deleted from a vertex is only removed from the
+	 * counters of its pointset, and physically removed on the next build
+	 * or by Vertex#compact.
+	 *
+	 * @see PointSet#mark_deleted
+	 */
+	bool use_tombstones;
+
+	/**
+	 * Maximal number of updates buffered before reaching the children
+	 *
+	 * If 0, updates are propagated to the children at once. Else, the
+	 * pointset of a vertex is updated at once, but the updates are kept in
+	 * its buffer and pushed to the children in bulk when the buffer is
+	 * full, or when the children are read.
+	 */
+	unsigned int buffer_size;
+
+	/**
+	 * Rebuild time allowed per root update, for each vertex, in ms
+	 *
+	 * If 0, the rebuild rule uses {@link #epsilon epsilon}. Else, on each
+	 * rebuild, the epsilon of the vertex is tuned so that the time of its
+	 * rebuilds, amortized over the updates of the whole tree, matches this
+	 * budget.
+	 */
+	double update_time_budget;
+
+	/// Upper bound of the epsilon tuned by each vertex
+	float epsilon_max;
+
+	/**
+	 * Depth down to which a batch of updates is split between threads
+	 *
+	 * If not 0, the vertices above this depth give the part of a batch
+	 * going to their under child to another thread, and apply the one going
+	 * to their over child themselves. The subtrees at this depth are hence
+	 * updated in parallel, and the rebuild thresholds they return are
+	 * handled by the thread of their parent once both are done.
+	 *
+	 * @see Vertex#apply_batch
+	 */
+	unsigned int parallel_depth;
+
+	/**
+	 * Indicates whether several threads may update the tree at once
+	 *
+	 * When true, each vertex has a lock, see Vertex#update_concurrently.
+	 */
+	bool use_concurrent_writers;
+
+	/// Number of updates made on the tree, counted by the root
+	std::atomic<unsigned long> nb_root_updates;
+
+	/**
+	 * Number of points marked as deleted and not purged yet, in the
+	 * pointsets of the tree and of its shadow subtrees
+	 *
+	 * While this is not 0, points deleted from the tree may still be
+	 * referenced and should not be freed.
+	 *
+	 * @see PointSet#mark_deleted
+	 */
+	std::atomic<unsigned int> nb_tombstones;
+
+	/**
+	 * Number of pending rebuilds in the tree
+	 *
+	 * While this is not 0, points deleted from the tree may still be
+	 * referenced by a pending rebuild and should not be freed.
+	 *
+	 * @see Vertex#pending
+	 */
+	std::atomic<unsigned int> nb_pending_rebuilds;
+
+	/**
+	 * Number of background threads building a shadow subtree of the tree
+	 *
+	 * Such a thread may still run after its rebuild has been cancelled, and
+	 * reads the points of the tree and this config until it completes.
+	 *
+	 * @see Vertex#build_in_background
+	 */
+	std::atomic<unsigned int> nb_background_builds;
+
+	/**
+	 * Number of deletions buffered in the tree
+	 *
+	 * While this is not 0, points deleted from the tree may still be
+	 * referenced by a buffer and should not be freed.
+	 *
+	 * @see Vertex#buffer
+	 */
+	std::atomic<unsigned int> nb_buffered_deletions;
+
+	/// Memory of the vertices of the tree
+	VertexArena arena;
+
+	/**
+	 * Constructor of TreeConfig
+	 *
+	 * The other settings are disabled.
+	 *
+	 * @param epsilon The epsilon parameter of the algorithm
+	 * @param epsilon_transmission Epsilon value to use when figuring out
+	 * 	which vertex to recompute
+	 * @param min_split_points Minimal number of points in the pointset to
+	 * 	allow splitting
+	 * @param min_split_gini Minimal gini value of the pointset to allow
+	 * 	splitting
+	 */
+	TreeConfig(float epsilon, float epsilon_transmission, unsigned int min_split_points, float min_split_gini);
+
+	/**
+	 * Enhanced copy constructor of TreeConfig
+	 *
+	 * All the settings but epsilon and epsilon_transmission are copied from
+	 * source. The counters start from 0 and the arena is empty.
+	 *
+	 * @param source The settings to copy
+	 * @param epsilon The new epsilon parameter
+	 * @param epsilon_transmission The new epsilon_transmission parameter
+	 */
+	TreeConfig(const TreeConfig& source, float epsilon, float epsilon_transmission);
+};
+#endif // TREECONFIG_H_INCLUDED
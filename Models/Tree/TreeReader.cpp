@@ -0,0 +1,123 @@
+#include "TreeReader.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+size_t TreeReader::get_segment_size(uint32_t node_capacity, uint32_t categories_capacity)
+{
+	size_t buffer_size = sizeof(shared_buffer) + node_capacity * sizeof(FlatTree::node) + categories_capacity * sizeof(uint64_t);
+	return sizeof(shared_header) + 2 * buffer_size;
+}
+
+TreeReader::shared_buffer* TreeReader::get_buffer(const shared_header* header, uint64_t index)
+{
+	size_t buffer_size = sizeof(shared_buffer) + header->node_capacity * sizeof(FlatTree::node) + header->categories_capacity * sizeof(uint64_t);
+	char* first_buffer = (char*)header + sizeof(shared_header);
+	return (shared_buffer*)(first_buffer + index * buffer_size);
+}
+
+FlatTree::node* TreeReader::get_nodes(shared_buffer* buffer)
+{
+	return (FlatTree::node*)(buffer + 1);
+}
+
+uint64_t* TreeReader::get_categories(const shared_header* header, shared_buffer* buffer)
+{
+	return (uint64_t*)(TreeReader::get_nodes(buffer) + header->node_capacity);
+}
+
+TreeReader::TreeReader(const std::string& name) :
+	segment(MAP_FAILED),
+	segment_size(0),
+	header(NULL)
+{
+	int descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+	if(descriptor == -1)
+		throw std::runtime_error("Error : could not open the shared memory " + name);
+	struct stat status;
+	if(fstat(descriptor, &status) == 0 && (size_t)status.st_size >= sizeof(shared_header))
+	{
+		this->segment_size = status.st_size;
+		this->segment = mmap(NULL, this->segment_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	}
+	close(descriptor);
+	if(this->segment == MAP_FAILED)
+		throw std::runtime_error("Error : could not map the shared memory " + name);
+	this->header = (const shared_header*)this->segment;
+	if(this->header->magic.load(std::memory_order_acquire) != MAGIC
+		|| this->segment_size < TreeReader::get_segment_size(this->header->node_capacity, this->header->categories_capacity))
+	{
+		munmap(this->segment, this->segment_size);
+		throw std::runtime_error("Error : the shared memory " + name + " does not hold a tree");
+	}
+}
+
+TreeReader::~TreeReader()
+{
+	munmap(this->segment, this->segment_size);
+}
+
+uint64_t TreeReader::get_version() const
+{
+	return this->header->version.load(std::memory_order_acquire);
+}
+
+size_t TreeReader::get_dimension() const
+{
+	return this->header->dimension;
+}
+
+bool TreeReader::walk(shared_buffer* buffer, const float* features, bool& decision) const
+{
+	const FlatTree::node* nodes = TreeReader::get_nodes(buffer);
+	const uint64_t* categories = TreeReader::get_categories(this->header, buffer);
+	const uint32_t nb_nodes = std::min(buffer->nb_nodes, this->header->node_capacity);
+	const uint32_t nb_categories = std::min(buffer->nb_categories, this->header->categories_capacity);
+	uint32_t index = 0;
+	// A walk longer than the number of nodes went through a cycle
+	for(uint32_t step = 0; step < nb_nodes && index < nb_nodes; step++)
+	{
+		const FlatTree::node current = nodes[index];
+		if(current.kind == FlatTree::LEAF_TRUE || current.kind == FlatTree::LEAF_FALSE)
+		{
+			decision = current.kind == FlatTree::LEAF_TRUE;
+			return true;
+		}
+		if(current.feature >= this->header->dimension || current.child >= nb_nodes - 1)
+			return false;
+		// Written as in Vertex#get_child_for, so that NaN goes right
+		if(current.kind == FlatTree::REAL_SPLIT)
+			index = current.child + !(features[current.feature] <= current.threshold);
+		else if(current.kind == FlatTree::EQUALITY_SPLIT)
+			index = current.child + (features[current.feature] == current.threshold);
+		else if(current.kind == FlatTree::SUBSET_SPLIT && current.categories_index < nb_categories)
+			index = current.child + PointSet::is_in_categories(categories[current.categories_index], features[current.feature]);
+		else
+			return false;
+	}
+	return false;
+}
+
+bool TreeReader::decision(const float* features) const
+{
+	while(true)
+	{
+		uint64_t version = this->header->version.load(std::memory_order_acquire);
+		if(version == 0)
+			throw std::runtime_error("Error : no tree has been published yet");
+		shared_buffer* buffer = TreeReader::get_buffer(this->header, version % 2);
+		uint64_t sequence = buffer->sequence.load(std::memory_order_acquire);
+		if(sequence % 2 == 1)
+			continue;
+		bool result = false;
+		bool is_walked = this->walk(buffer, features, result);
+		// The nodes read should not be reordered after the check
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(is_walked && buffer->sequence.load(std::memory_order_relaxed) == sequence)
+			return result;
+	}
+}
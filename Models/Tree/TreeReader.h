@@ -0,0 +1,151 @@
+/**
+ * @file TreeReader.h
+ * Definition of class TreeReader
+ */
+#ifndef TREEREADER_H_INCLUDED
+#define TREEREADER_H_INCLUDED
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include "FlatTree.h"
+
+/**
+ * Read-only view of a tree published in shared memory by another process
+ *
+ * The segment is written by a SharedTreeWriter and holds two buffers of
+ * FlatTree nodes : the writer fills the one not published last, then
+ * publishes it by increasing the version of the segment. Each buffer has a
+ * sequence number, odd while it is written, as a seqlock : a decision walks
+ * the nodes where they are mapped, and is made again if the buffer has been
+ * overwritten in the meantime, which only happens if the reader was delayed
+ * for two publications.
+ *
+ * Decisions are bounded to the capacity of the segment, hence a buffer
+ * overwritten during a walk gives a wrong decision, which is discarded, but
+ * never reads outside of the segment.
+ */
+class TreeReader {
+	public:
+		/// Value of shared_header#magic once the segment is initialised
+		static const uint32_t MAGIC = 0x44545231;
+
+		/// Beginning of the segment
+		struct shared_header {
+			/// #MAGIC, written once the rest of the header is
+			std::atomic<uint32_t> magic;
+			/// Number of features of the points
+			uint32_t dimension;
+			/// Maximal number of nodes of a buffer
+			uint32_t node_capacity;
+			/// Maximal number of categories of a buffer
+			uint32_t categories_capacity;
+			/// Number of publications, the last one being in buffer version%2
+			std::atomic<uint64_t> version;
+		};
+
+		/// Beginning of a buffer, followed by its nodes then its categories
+		struct shared_buffer {
+			/// Number of writes of the buffer started or ended, odd while written
+			std::atomic<uint64_t> sequence;
+			/// Number of nodes, the root being the first one
+			uint32_t nb_nodes;
+			/// Number of categories of the subset splits
+			uint32_t nb_categories;
+		};
+
+		/**
+		 * Size of a segment
+		 *
+		 * @param node_capacity Maximal number of nodes of a buffer
+		 * @param categories_capacity Maximal number of categories of a buffer
+		 */
+		static size_t get_segment_size(uint32_t node_capacity, uint32_t categories_capacity);
+
+		/**
+		 * Position of a buffer in a segment
+		 *
+		 * @param header The header of the segment
+		 * @param index The index of the buffer, 0 or 1
+		 */
+		static shared_buffer* get_buffer(const shared_header* header, uint64_t index);
+
+		/// The nodes of a buffer
+		static FlatTree::node* get_nodes(shared_buffer* buffer);
+
+		/**
+		 * The categories of a buffer
+		 *
+		 * @param header The header of the segment
+		 * @param buffer A buffer of the segment
+		 */
+		static uint64_t* get_categories(const shared_header* header, shared_buffer* buffer);
+
+	private:
+		/// The mapped segment
+		void* segment;
+
+		/// Size of the mapped segment
+		size_t segment_size;
+
+		/// The header of the mapped segment
+		const shared_header* header;
+
+		/**
+		 * Walk down a buffer
+		 *
+		 * @param buffer The buffer to read
+		 * @param features The features of the point to evaluate
+		 * @param decision Out argument, the decision if the walk ended on a
+		 * 	leaf
+		 * @return false if the walk left the nodes of the buffer, which may
+		 * 	only happen when the buffer was overwritten
+		 */
+		bool walk(shared_buffer* buffer, const float* features, bool& decision) const;
+
+	public:
+		/**
+		 * Map a segment published by a SharedTreeWriter
+		 *
+		 * @param name Name of the POSIX shared memory object, starting with
+		 * 	'/'
+		 * @throw std::runtime_error When the segment does not exist or has
+		 * 	not been initialised
+		 */
+		TreeReader(const std::string& name);
+
+		/// Copying would unmap the segment twice
+		TreeReader(const TreeReader&) = delete;
+
+		/// Copying would unmap the segment twice
+		TreeReader& operator=(const TreeReader&) = delete;
+
+		/**
+		 * Destructor of TreeReader
+		 *
+		 * Unmap the segment
+		 */
+		~TreeReader();
+
+		/**
+		 * Number of publications made in the segment
+		 *
+		 * If 0, no decision can be made yet.
+		 */
+		uint64_t get_version() const;
+
+		/// Number of features of the points
+		size_t get_dimension() const;
+
+		/**
+		 * The decision of the last published tree for the given features
+		 *
+		 * This does not take a lock, and does not copy the nodes.
+		 *
+		 * @param features The features of the point to evaluate, of
+		 * 	TreeReader#get_dimension elements. No ownership is taken
+		 * @throw std::runtime_error When nothing has been published yet
+		 */
+		bool decision(const float* features) const;
+};
+#endif // TREEREADER_H_INCLUDED
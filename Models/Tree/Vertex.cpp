@@ -1,100 +1,206 @@
 #include "Vertex.h"
 
 #include <math.h>
+#include <cmath>
+#include <climits>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <future>
 
-unsigned int Vertex::nb_build = 0;
+std::atomic<unsigned int> Vertex::nb_build(0);
 
-Vertex::Vertex(PointSet* pointset, Vertex* parent, unsigned int remaining_high, float epsilon, unsigned int min_split_points, float min_split_gini, float epsilon_transmission, bool is_root) :
+Vertex::Vertex(PointSet* pointset, Vertex* parent, unsigned int remaining_high, TreeConfig* config, bool is_root) :
+	is_dirty(false),
+	is_uniform(false),
+	uniform_decision(false),
+	under_child(NULL),
+	over_child(NULL),
+	pointset(pointset),
+	parent(parent),
+	config(config),
 	is_root(is_root),
 	remaining_high(remaining_high),
-	epsilon(epsilon),
-	parent(parent),
-	pointset(pointset),
-	min_split_points(min_split_points),
-	min_split_gini(min_split_gini),
-	epsilon_transmission(epsilon_transmission),
+	size_at_building(0),
+	rebuild_policy(parent == NULL ? new EpsilonRebuildPolicy() : parent->rebuild_policy->clone()),
+	deferred_threshold(0),
+	adapted_epsilon(parent == NULL ? config->epsilon : parent->adapted_epsilon),
+	build_time_per_point(0),
+	is_flush_needed(false),
+	is_flat_stale(true),
+	flat_index(UINT_MAX),
+	pending(NULL),
+	writers(config->use_concurrent_writers ? new writer_lock() : NULL)
+{
+	this->build();
+}
+
+Vertex::Vertex(PointSet* pointset, const Vertex& model, Vertex* parent, unsigned int remaining_high) :
+	is_leaf(true),
+	is_dirty(false),
+	is_uniform(false),
+	uniform_decision(false),
 	under_child(NULL),
 	over_child(NULL),
-	size_at_building(0)
+	pointset(pointset),
+	parent(parent),
+	config(model.config),
+	is_root(false),
+	remaining_high(remaining_high),
+	size_at_building(0),
+	rebuild_policy(model.rebuild_policy->clone()),
+	deferred_threshold(0),
+	adapted_epsilon(model.adapted_epsilon),
+	build_time_per_point(model.build_time_per_point),
+	is_flush_needed(false),
+	is_flat_stale(true),
+	flat_index(UINT_MAX),
+	pending(NULL),
+	writers(config->use_concurrent_writers ? new writer_lock() : NULL)
 {
-	this->build();
+	this->begin_build();
+	this->refresh_training_error();
 }
 
 Vertex::Vertex(const Vertex& source, Vertex* parent, PointSet* pointset) :
-	is_leaf(source.is_leaf),
-	is_root(source.is_root),
 	split_parameter(source.split_parameter),
 	split_threshold(source.split_threshold),
-	remaining_high(source.remaining_high),
-	updates_since_last_build(source.updates_since_last_build),
-	epsilon(parent->epsilon),
-	parent(parent),
-	pointset(pointset),
-	min_split_points(source.min_split_points),
-	min_split_gini(source.min_split_gini),
-	epsilon_transmission(parent->epsilon_transmission),
+	is_leaf(source.is_leaf),
+	is_dirty(source.is_dirty),
+	is_uniform(false),
+	uniform_decision(false),
+	split_categories(source.split_categories),
 	under_child(NULL),
 	over_child(NULL),
-	size_at_building(source.size_at_building)
+	pointset(pointset),
+	parent(parent),
+	config(parent->config),
+	is_root(source.is_root),
+	remaining_high(source.remaining_high),
+	updates_since_last_build(source.updates_since_last_build),
+	size_at_building(source.size_at_building),
+	certified_updates(source.certified_updates),
+	rebuild_policy(source.rebuild_policy->clone()),
+	deferred_threshold(0),
+	adapted_epsilon(parent->config->epsilon),
+	build_time_per_point(source.build_time_per_point),
+	root_updates_at_building(0),
+	is_flush_needed(false),
+	is_flat_stale(true),
+	flat_index(UINT_MAX),
+	pending(NULL),
+	writers(config->use_concurrent_writers ? new writer_lock() : NULL)
 {
 	if(!this->is_leaf)
 	{
 		auto subsets = this->pointset->split_at_best_multiset();
-		this->under_child = new Vertex(*source.under_child, this, new PointSet(*source.under_child->pointset, subsets[0]));
-		this->over_child = new Vertex(*source.over_child, this, new PointSet(*source.over_child->pointset, subsets[1]));
+		this->under_child = new(this->config->arena.allocate()) Vertex(*source.under_child, this, new PointSet(*source.under_child->pointset, subsets[0]));
+		this->over_child = new(this->config->arena.allocate()) Vertex(*source.over_child, this, new PointSet(*source.over_child->pointset, subsets[1]));
+		this->is_flush_needed = this->under_child->is_flush_needed || this->over_child->is_flush_needed;
 	}
+	this->is_flush_needed = this->is_flush_needed || this->is_dirty;
+	this->refresh_uniform();
+	this->refresh_training_error();
 }
 
-Vertex::Vertex(const Vertex& source, float epsilon, float epsilon_transmission, std::multiset<Point*> new_points) :
-	is_leaf(source.is_leaf),
-	is_root(source.is_root),
+Vertex::Vertex(const Vertex& source, TreeConfig* config, std::multiset<Point*> new_points) :
 	split_parameter(source.split_parameter),
 	split_threshold(source.split_threshold),
-	remaining_high(source.remaining_high),
-	updates_since_last_build(source.updates_since_last_build),
-	epsilon(epsilon),
-	parent(NULL),
-	pointset(new PointSet(*source.pointset, new_points)),
-	min_split_points(source.min_split_points),
-	min_split_gini(source.min_split_gini),
-	epsilon_transmission(epsilon_transmission),
+	is_leaf(source.is_leaf),
+	is_dirty(source.is_dirty),
+	is_uniform(false),
+	uniform_decision(false),
+	split_categories(source.split_categories),
 	under_child(NULL),
 	over_child(NULL),
-	size_at_building(source.size_at_building)
+	pointset(new PointSet(*source.pointset, new_points)),
+	parent(NULL),
+	config(config),
+	is_root(source.is_root),
+	remaining_high(source.remaining_high),
+	updates_since_last_build(source.updates_since_last_build),
+	size_at_building(source.size_at_building),
+	certified_updates(source.certified_updates),
+	rebuild_policy(source.rebuild_policy->clone()),
+	deferred_threshold(0),
+	adapted_epsilon(config->epsilon),
+	build_time_per_point(source.build_time_per_point),
+	root_updates_at_building(0),
+	is_flush_needed(false),
+	is_flat_stale(true),
+	flat_index(UINT_MAX),
+	pending(NULL),
+	writers(config->use_concurrent_writers ? new writer_lock() : NULL)
 {
 	if(!this->is_leaf)
 	{
 		auto subsets = this->pointset->split_at_best_multiset();
-		this->under_child = new Vertex(*source.under_child, this, new PointSet(*source.under_child->pointset, subsets[0]));
-		this->over_child = new Vertex(*source.over_child, this, new PointSet(*source.over_child->pointset, subsets[1]));
+		this->under_child = new(this->config->arena.allocate()) Vertex(*source.under_child, this, new PointSet(*source.under_child->pointset, subsets[0]));
+		this->over_child = new(this->config->arena.allocate()) Vertex(*source.over_child, this, new PointSet(*source.over_child->pointset, subsets[1]));
+		this->is_flush_needed = this->under_child->is_flush_needed || this->over_child->is_flush_needed;
 	}
+	this->is_flush_needed = this->is_flush_needed || this->is_dirty;
+	this->refresh_uniform();
+	this->refresh_training_error();
 }
 
 Vertex::~Vertex()
 {
-	delete this->pointset;
+	this->cancel_pending_rebuild();
+	this->clear_buffer();
+	delete this->rebuild_policy;
+	this->free_pointset();
+	delete this->writers;
 	if(this->under_child != NULL)
 	{
-		delete this->under_child;
+		Vertex::destroy(this->under_child);
 		this->under_child=NULL;
-		delete this->over_child;
+		Vertex::destroy(this->over_child);
 		this->over_child=NULL;
 	}
 }
 
+void Vertex::destroy(Vertex* vertex)
+{
+	VertexArena& arena = vertex->config->arena;
+	vertex->~Vertex();
+	arena.release(vertex);
+}
+
 void Vertex::build()
+{
+	const auto start = std::chrono::steady_clock::now();
+	this->begin_build();
+	this->end_build(false);
+	const std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - start;
+	this->build_time_per_point = this->size_at_building == 0 ? 0 : build_time.count() / this->size_at_building;
+}
+
+void Vertex::begin_build()
 {
 	Vertex::nb_build++;
 	this->size_at_building=this->pointset->get_size();
+	this->root_updates_at_building = this->config->nb_root_updates;
+	this->purge_pointset();
+	this->is_dirty = false;
+	this->deferred_threshold = 0;
+	this->cancel_pending_rebuild();
+	this->clear_buffer();
 	// If this has already been built, free memory of children
 	if(this->under_child != NULL)
 	{
-		delete this->under_child;
+		Vertex::destroy(this->under_child);
 		this->under_child=NULL;
-		delete this->over_child;
+		Vertex::destroy(this->over_child);
 		this->over_child=NULL;
 	}
-	if(this->remaining_high == 0 ||	this->pointset->get_size() <= this->min_split_points || this->pointset->get_gini() <= this->min_split_gini || this->pointset->get_best_gain() <= 0)
+}
+
+void Vertex::end_build(bool is_deferred)
+{
+	if(this->remaining_high == 0 ||	this->pointset->get_size() <= this->config->min_split_points || this->pointset->get_gini() <= this->config->min_split_gini || this->pointset->get_best_gain() <= 0)
 	{
 		this->is_leaf = true;
 	}
@@ -103,98 +209,969 @@ void Vertex::build()
 		this->is_leaf = false;
 		this->split_parameter = this->pointset->get_best_index();
 		this->split_threshold = this->pointset->get_best_threshold();
+		this->split_categories = this->pointset->get_best_categories();
 		auto subsets = this->pointset->split_at_best();
-		this->under_child = new Vertex(subsets[0], this, remaining_high-1, this->epsilon, this->min_split_points, this->min_split_gini, this->epsilon_transmission);
-		this->over_child = new Vertex(subsets[1], this, remaining_high-1, this->epsilon, this->min_split_points, this->min_split_gini, this->epsilon_transmission);
+		if(is_deferred)
+		{
+			this->under_child = new(this->config->arena.allocate()) Vertex(subsets[0], *this, this, remaining_high-1);
+			this->over_child = new(this->config->arena.allocate()) Vertex(subsets[1], *this, this, remaining_high-1);
+		}
+		else
+		{
+			this->under_child = new(this->config->arena.allocate()) Vertex(subsets[0], this, remaining_high-1, this->config);
+			this->over_child = new(this->config->arena.allocate()) Vertex(subsets[1], this, remaining_high-1, this->config);
+		}
 	}
 	this->updates_since_last_build = 0;
+	this->compute_certificate();
+	this->rebuild_policy->reset(*this);
+	this->refresh_uniform();
+	this->refresh_training_error();
+	this->mark_flat_stale();
+}
+
+bool Vertex::advance_build(unsigned long& budget)
+{
+	// The gain is only needed when the other conditions do not make a leaf
+	if(!(this->remaining_high == 0 || this->pointset->get_size() <= this->config->min_split_points || this->pointset->get_gini() <= this->config->min_split_gini)
+		&& !this->pointset->advance_best_gain(budget))
+		return false;
+	this->end_build(true);
+	// Splitting goes through all the points
+	if(!this->is_leaf)
+		budget -= std::min(budget, (unsigned long)this->size_at_building);
+	return true;
+}
+
+void Vertex::adapt_epsilon()
+{
+	unsigned long nb_root_updates = this->config->nb_root_updates - this->root_updates_at_building;
+	if(this->config->update_time_budget <= 0 || nb_root_updates == 0)
+		return;
+	// Rebuilding takes about build_time_per_point*size_at_building, and is
+	// made every adapted_epsilon*size_at_building updates of this vertex
+	double update_rate = (double)this->updates_since_last_build / nb_root_updates;
+	double target = update_rate * this->build_time_per_point / this->config->update_time_budget;
+	this->adapted_epsilon = (float)std::min(std::max(target, (double)this->config->epsilon), (double)this->config->epsilon_max);
+}
+
+void Vertex::rebuild()
+{
+	// The rebuild would be lost at the swap
+	if(this->is_replaced_by_pending_rebuild())
+		return;
+	this->adapt_epsilon();
+	if(this->config->is_lazy)
+	{
+		// The children stop being updated, hence their buffers may refer to
+		// deleted points, and are never applied
+		this->cancel_pending_rebuild();
+		this->clear_buffer();
+		this->is_dirty = true;
+		this->is_uniform = false;
+		this->mark_flush_needed();
+		this->mark_flat_stale();
+		return;
+	}
+	bool is_async = this->config->async_min_size > 0 && this->pointset->get_size() >= this->config->async_min_size;
+	if(!this->is_rebuild_deferred())
+		this->build();
+	else if(this->pending == NULL)
+	{
+		this->config->nb_pending_rebuilds++;
+		this->pending = new pending_rebuild();
+		// The shadow has no parent, so that its builds, which may be made by
+		// another thread, do not mark the current subtree as stale
+		this->config->nb_tombstones += this->pointset->get_nb_tombstones();
+		this->pending->shadow = new(this->config->arena.allocate()) Vertex(new PointSet(*this->pointset), *this, NULL, this->remaining_high);
+		this->pending->nb_replayed = 0;
+		if(is_async)
+		{
+			// The shadow and its snapshot of points are only accessed by the
+			// background thread until it completes. If the rebuild is
+			// cancelled in the meantime, the thread frees the shadow itself
+			this->pending->background = std::make_shared<background_build>();
+			this->pending->background->state = background_state::RUNNING;
+			this->pending->background->nb_replayed = 0;
+			this->config->nb_background_builds++;
+			std::thread(Vertex::build_in_background, this->pending->shadow, this->pending->background).detach();
+		}
+		else
+		{
+			// The update that triggered the rebuild gives its budget
+			this->pending->to_build.push_back(this->pending->shadow);
+			this->advance_pending_rebuild();
+		}
+	}
+}
+
+bool Vertex::is_rebuild_deferred() const
+{
+	if(this->config->is_lazy)
+		return false;
+	return this->config->rebuild_budget > 0 || (this->config->async_min_size > 0 && this->pointset->get_size() >= this->config->async_min_size);
+}
+
+void Vertex::build_in_background(Vertex* shadow, std::shared_ptr<background_build> background)
+{
+	// The shadow belongs to the writer thread once done, while the config
+	// is freed by the tree only after this thread completes
+	TreeConfig* config = shadow->config;
+	const auto start = std::chrono::steady_clock::now();
+	shadow->end_build(false);
+	const std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - start;
+	shadow->build_time_per_point = shadow->size_at_building == 0 ? 0 : build_time.count() / shadow->size_at_building;
+	std::vector<std::pair<Point*, bool>> to_replay;
+	bool is_cancelled = false;
+	size_t nb_last_replayed = std::numeric_limits<size_t>::max();
+	while(!is_cancelled)
+	{
+		{
+			std::lock_guard<std::mutex> lock(background->mutex);
+			is_cancelled = background->state == background_state::CANCELLED;
+			if(is_cancelled)
+				break;
+			// The replay may not catch up with the updates, as it costs as
+			// much as them. The writer thread then replays the rest at once
+			size_t nb_remaining = background->missed_updates.size() - background->nb_replayed;
+			if(nb_remaining == 0 || nb_remaining >= nb_last_replayed)
+			{
+				background->state = background_state::DONE;
+				background->is_done.notify_all();
+				break;
+			}
+			nb_last_replayed = nb_remaining;
+			to_replay.assign(background->missed_updates.begin() + background->nb_replayed, background->missed_updates.end());
+			background->nb_replayed = background->missed_updates.size();
+		}
+		for(auto it = to_replay.begin(); it != to_replay.end(); it++)
+			shadow->update_without_rebuild(it->first, it->second);
+	}
+	if(is_cancelled)
+	{
+		Vertex::destroy(shadow);
+		config->nb_pending_rebuilds--;
+	}
+	config->nb_background_builds--;
+}
+
+void Vertex::log_missed_update(Point* point, bool is_add)
+{
+	if(this->pending->background)
+	{
+		std::lock_guard<std::mutex> lock(this->pending->background->mutex);
+		this->pending->background->missed_updates.push_back(std::make_pair(point, is_add));
+	}
+	else
+		this->pending->missed_updates.push_back(std::make_pair(point, is_add));
+}
+
+void Vertex::advance_pending_rebuild()
+{
+	unsigned long budget = this->config->rebuild_budget;
+	// The vertices of the current subtree are not rebuilt while the rebuild
+	// is pending, hence how late it may be is bounded
+	bool is_lag_bounded = this->config->max_pending_lag > 0;
+	double max_lag = this->config->max_pending_lag * this->adapted_epsilon * this->size_at_building;
+	if(this->pending->background)
+	{
+		background_build& background = *this->pending->background;
+		std::unique_lock<std::mutex> lock(background.mutex);
+		// No update is logged while waiting, so the thread catches up
+		if(is_lag_bounded && background.missed_updates.size() > max_lag)
+			background.is_done.wait(lock, [&background]{return background.state == background_state::DONE;});
+		if(background.state != background_state::DONE)
+			return;
+		// The updates logged after the background thread caught up are
+		// replayed at once
+		this->pending->missed_updates.assign(background.missed_updates.begin() + background.nb_replayed, background.missed_updates.end());
+		this->pending->nb_replayed = 0;
+		budget = ULONG_MAX;
+	}
+	else if(is_lag_bounded && this->pending->missed_updates.size() > max_lag)
+		budget = ULONG_MAX;
+	std::deque<Vertex*>& to_build = this->pending->to_build;
+	while(budget > 0 && !to_build.empty())
+	{
+		Vertex* current = to_build.front();
+		if(!current->advance_build(budget))
+			break;
+		to_build.pop_front();
+		if(!current->is_leaf)
+		{
+			to_build.push_back(current->under_child);
+			to_build.push_back(current->over_child);
+		}
+	}
+	if(!to_build.empty())
+		return;
+
+	// Replaying costs one operation per vertex on the path. At least two
+	// updates are replayed per step so that the replay catches up
+	std::vector<std::pair<Point*, bool>>& missed_updates = this->pending->missed_updates;
+	Vertex* shadow = this->pending->shadow;
+	for(unsigned int nb_steps = 0; this->pending->nb_replayed < missed_updates.size() && (budget > 0 || nb_steps < 2); nb_steps++)
+	{
+		// The rebuilds the replay would trigger are made by the updates
+		// following the swap
+		std::pair<Point*, bool>& update = missed_updates[this->pending->nb_replayed++];
+		shadow->update_without_rebuild(update.first, update.second);
+		budget -= std::min(budget, (unsigned long)this->remaining_high + 1);
+	}
+	if(this->pending->nb_replayed < missed_updates.size())
+		return;
+
+	// --- Swap the shadow subtree in
+	if(this->under_child != NULL)
+	{
+		Vertex::destroy(this->under_child);
+		Vertex::destroy(this->over_child);
+	}
+	this->clear_buffer();
+	this->buffer.swap(shadow->buffer);
+	this->free_pointset();
+	this->is_leaf = shadow->is_leaf;
+	this->split_parameter = shadow->split_parameter;
+	this->split_threshold = shadow->split_threshold;
+	this->split_categories = shadow->split_categories;
+	this->updates_since_last_build = shadow->updates_since_last_build;
+	this->size_at_building = shadow->size_at_building;
+	this->certified_updates = shadow->certified_updates;
+	this->root_updates_at_building = shadow->root_updates_at_building;
+	if(shadow->build_time_per_point > 0)
+		this->build_time_per_point = shadow->build_time_per_point;
+	std::swap(this->rebuild_policy, shadow->rebuild_policy);
+	this->pointset = shadow->pointset;
+	this->under_child = shadow->under_child;
+	this->over_child = shadow->over_child;
+	if(!this->is_leaf)
+	{
+		this->under_child->parent = this;
+		this->over_child->parent = this;
+	}
+	shadow->pointset = NULL;
+	shadow->under_child = NULL;
+	shadow->over_child = NULL;
+	this->refresh_uniform_subtree();
+	// The build of the shadow in steps only refreshed the vertices built
+	this->refresh_training_error_subtree();
+	if(shadow->is_flush_needed)
+		this->mark_flush_needed();
+	this->mark_flat_stale();
+	this->cancel_pending_rebuild();
+}
+
+void Vertex::cancel_pending_rebuild()
+{
+	if(this->pending != NULL)
+	{
+		bool is_shadow_owned = true;
+		if(this->pending->background)
+		{
+			// A running background thread frees the shadow when it stops
+			std::lock_guard<std::mutex> lock(this->pending->background->mutex);
+			is_shadow_owned = this->pending->background->state == background_state::DONE;
+			this->pending->background->state = background_state::CANCELLED;
+		}
+		if(is_shadow_owned)
+		{
+			Vertex::destroy(this->pending->shadow);
+			this->config->nb_pending_rebuilds--;
+		}
+		delete this->pending;
+		this->pending = NULL;
+	}
+}
+
+void Vertex::compute_certificate()
+{
+	// Margins are expressed as size-weighted gini/gains, which move by less
+	// than 4 on each update
+	double size = (double)this->size_at_building;
+	double margin;
+	if(this->is_leaf)
+	{
+		if(this->remaining_high == 0)
+			margin = (double)UINT_MAX;
+		else if(this->size_at_building <= this->config->min_split_points)
+			margin = 4.0*(this->config->min_split_points - this->size_at_building);
+		else
+			margin = size*(this->config->min_split_gini - this->pointset->get_gini());
+	}
+	else
+	{
+		double best_gain = this->pointset->get_best_gain();
+		double second_best_gain = this->pointset->get_second_best_gain();
+		// A category or value unseen at build can create a new candidate split
+		// whose weighted gain is at most 2
+		margin = size*best_gain - 2;
+		if(!isnan(second_best_gain))
+			margin = std::min(margin, size*(best_gain - second_best_gain));
+		margin = std::min(margin, size*(this->pointset->get_gini() - this->config->min_split_gini));
+		margin = std::min(margin, 4.0*(this->size_at_building - this->config->min_split_points - 1));
+	}
+	this->certified_updates = margin <= 0 ? 0 : (unsigned int)std::min(margin/4, (double)UINT_MAX);
+}
+
+double Vertex::get_split_gain()
+{
+	if(this->is_leaf || this->pointset->get_size() == 0)
+		return 0;
+	double size = (double)this->pointset->get_size();
+	return this->pointset->get_gini()
+		- this->under_child->pointset->get_size()/size*this->under_child->pointset->get_gini()
+		- this->over_child->pointset->get_size()/size*this->over_child->pointset->get_gini();
+}
+
+void Vertex::set_rebuild_policy(const RebuildPolicy& rebuild_policy)
+{
+	delete this->rebuild_policy;
+	this->rebuild_policy = rebuild_policy.clone();
+	this->rebuild_policy->reset(*this);
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->set_rebuild_policy(rebuild_policy);
+		this->over_child->set_rebuild_policy(rebuild_policy);
+	}
+}
+
+void Vertex::set_use_subset_splits(bool use_subset_splits)
+{
+	this->pointset->set_use_subset_splits(use_subset_splits);
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->set_use_subset_splits(use_subset_splits);
+		this->over_child->set_use_subset_splits(use_subset_splits);
+	}
+}
+
+void Vertex::refresh_pruning()
+{
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->refresh_pruning();
+		this->over_child->refresh_pruning();
+	}
+	this->refresh_uniform();
+	this->mark_flat_stale();
+}
+
+void Vertex::refresh_writer_locks()
+{
+	if(this->config->use_concurrent_writers && this->writers == NULL)
+	{
+		this->writers = new writer_lock();
+		this->writers->nb_writers = 0;
+	}
+	else if(!this->config->use_concurrent_writers)
+	{
+		delete this->writers;
+		this->writers = NULL;
+	}
+	if(!this->is_leaf)
+	{
+		this->under_child->refresh_writer_locks();
+		this->over_child->refresh_writer_locks();
+	}
+}
+
+void Vertex::compact()
+{
+	this->purge_pointset();
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->compact();
+		this->over_child->compact();
+	}
+}
+
+void Vertex::append_leaf_points(std::vector<Point*>& to_fill)
+{
+	if(this->is_leaf || this->is_dirty)
+		this->pointset->append_points(to_fill);
+	else
+	{
+		this->under_child->append_leaf_points(to_fill);
+		this->over_child->append_leaf_points(to_fill);
+	}
+}
+
+void Vertex::relocate_points(const std::unordered_map<Point*, Point*>& relocated)
+{
+	this->pointset->relocate(relocated);
+	for(auto it = this->buffer.begin(); it != this->buffer.end(); it++)
+	{
+		auto copy = relocated.find(it->first);
+		if(copy != relocated.end())
+			it->first = copy->second;
+	}
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->relocate_points(relocated);
+		this->over_child->relocate_points(relocated);
+	}
+}
+
+void Vertex::fit_buffers()
+{
+	if(this->is_dirty)
+		return;
+	if(this->buffer.size() >= this->config->buffer_size && !this->buffer.empty())
+		this->flush_buffer();
+	if(!this->is_leaf && !this->is_dirty)
+	{
+		this->under_child->fit_buffers();
+		this->over_child->fit_buffers();
+	}
+	this->refresh_training_error();
+}
+
+void Vertex::refresh_epsilon()
+{
+	if(this->config->update_time_budget <= 0)
+		this->adapted_epsilon = this->config->epsilon;
+	else
+		this->adapted_epsilon = std::min(std::max(this->adapted_epsilon, this->config->epsilon), this->config->epsilon_max);
+	if(!this->is_leaf)
+	{
+		this->under_child->refresh_epsilon();
+		this->over_child->refresh_epsilon();
+	}
+}
+
+void Vertex::reconfigure(unsigned int remaining_high)
+{
+	this->cancel_pending_rebuild();
+	this->remaining_high = remaining_high;
+	// A dirty vertex is rebuilt with the new parameters when read
+	if(this->is_dirty)
+		return;
+	bool is_leaf_by_parameters = this->remaining_high == 0 || this->pointset->get_size() <= this->config->min_split_points || this->pointset->get_gini() <= this->config->min_split_gini;
+	if(this->is_leaf ? !is_leaf_by_parameters && this->pointset->get_best_gain() > 0 : is_leaf_by_parameters)
+		this->build();
+	else
+	{
+		// The certificate of the last build relied on the previous parameters
+		this->certified_updates = 0;
+		if(!this->is_leaf)
+		{
+			this->under_child->reconfigure(remaining_high-1);
+			this->over_child->reconfigure(remaining_high-1);
+		}
+		this->refresh_uniform();
+		this->refresh_training_error();
+	}
+}
+
+void Vertex::flush()
+{
+	if(!this->is_flush_needed)
+		return;
+	if(!this->is_dirty && !this->buffer.empty())
+		this->flush_buffer();
+	if(this->is_dirty)
+		this->build();
+	else if(!this->is_leaf)
+	{
+		this->under_child->flush();
+		this->over_child->flush();
+	}
+	this->refresh_training_error();
+	this->is_flush_needed = false;
 }
 
 unsigned int Vertex::add_point(Point* new_point)
 {
 	this->pointset->add_point(new_point);
-	/// @todo put the decision making part in a separate function to make it common to both update operations
+	// A rebuild started by this update has already been given its budget
+	bool is_pending = this->pending != NULL;
+	if(is_pending)
+		this->log_missed_update(new_point, true);
+	unsigned int threshold = this->propagate_update(new_point, true);
+	if(is_pending && this->pending != NULL)
+		this->advance_pending_rebuild();
+	return threshold;
+}
+
+unsigned int Vertex::delete_point(Point* old_point)
+{
+	this->remove_from_pointset(old_point);
+	bool is_pending = this->pending != NULL;
+	if(is_pending)
+		this->log_missed_update(old_point, false);
+	unsigned int threshold = this->propagate_update(old_point, false);
+	if(is_pending && this->pending != NULL)
+		this->advance_pending_rebuild();
+	return threshold;
+}
+
+unsigned int Vertex::propagate_update(Point* point, bool is_add)
+{
 	this->updates_since_last_build++;
-	if(this->updates_since_last_build >= epsilon*this->size_at_building)
+	if(this->is_root)
+		this->config->nb_root_updates++;
+	if(this->is_leaf)
+		this->mark_flat_stale();
+	// The subtree of a dirty vertex is rebuilt from its pointset when read
+	if(this->is_dirty)
+		return 0;
+	unsigned int threshold = this->deferred_threshold;
+	this->deferred_threshold = 0;
+	// The counters of a vertex being rebuilt are the ones of the shadow
+	// subtree once it is swapped in
+	bool is_rebuild_needed = this->pending == NULL && this->rebuild_policy->is_rebuild_needed(*this, point, is_add);
+	if(is_rebuild_needed)
+		threshold = this->get_rebuild_threshold();
+
+	// When this vertex is rebuilt at once, updating children that are about
+	// to be rebuilt is useless. Else, the current subtree keeps making
+	// decisions until the rebuild is effective, hence it should keep being
+	// updated, but not rebuilt
+	if(!this->is_leaf && (this->pending != NULL || (is_rebuild_needed && this->is_rebuild_deferred())))
+		this->route_without_rebuild(point, is_add);
+	else if(!this->is_leaf && !is_rebuild_needed)
 	{
-		if(this->is_root) // If is root, parent can not call rebuild
-			this->build();
+		if(this->config->buffer_size == 0)
+			threshold = std::max(threshold, this->route_update(point, is_add));
+		else
+		{
+			this->buffer_update(point, is_add);
+			if(this->buffer.size() >= this->config->buffer_size)
+				threshold = std::max(threshold, this->apply_buffer());
+		}
+	}
+
+	if(threshold > 0 && this->is_root) // If is root, parent can not call rebuild
+		this->rebuild();
+	this->refresh_uniform();
+	this->refresh_training_error();
+	return threshold;
+}
+
+unsigned int Vertex::route_update(Point* point, bool is_add)
+{
+	Vertex* to_update = this->get_child_for(point->get_features());
+	unsigned int child_threshold = is_add ? to_update->add_point(point) : to_update->delete_point(point);
+	if(child_threshold > 0 && (this->size_at_building < child_threshold || (!is_add && this->size_at_building == child_threshold)))
+		return child_threshold;
+	else if(child_threshold > 0)
+		to_update->rebuild();
+	return 0;
+}
 
-		// Casting will truncate. Since the theoritical result is an integer, the calculated result will be very close to an integer.
-		// The 0.5 added to the calculated result ensures that is it above the theoritical result and therefore equals to it after truncate
-		return (unsigned int)(pow(1.0+epsilon_transmission, ceil(log((double)this->size_at_building)/log(1.0+epsilon_transmission))) + 0.5);
+void Vertex::update_without_rebuild(Point* point, bool is_add)
+{
+	if(is_add)
+		this->pointset->add_point(point);
+	else
+		this->remove_from_pointset(point);
+	if(this->is_leaf)
+		this->mark_flat_stale();
+	if(this->is_dirty)
+		return;
+	this->cancel_pending_rebuild();
+	if(!this->is_leaf)
+		this->route_without_rebuild(point, is_add);
+	this->refresh_uniform();
+	this->refresh_training_error();
+}
+
+void Vertex::route_without_rebuild(Point* point, bool is_add)
+{
+	// The buffered updates reach the children before this one
+	if(!this->buffer.empty())
+	{
+		std::vector<std::pair<Point*, bool>> to_apply;
+		to_apply.swap(this->buffer);
+		this->mark_flat_stale();
+		for(auto it = to_apply.begin(); it != to_apply.end(); it++)
+		{
+			if(!it->second)
+				this->config->nb_buffered_deletions--;
+			this->get_child_for(it->first->get_features())->update_without_rebuild(it->first, it->second);
+		}
 	}
-	else if(!this->is_leaf)
+	this->get_child_for(point->get_features())->update_without_rebuild(point, is_add);
+}
+
+bool Vertex::is_replaced_by_pending_rebuild() const
+{
+	for(Vertex* vertex = this->parent; vertex != NULL; vertex = vertex->parent)
+		if(vertex->pending != NULL)
+			return true;
+	return false;
+}
+
+unsigned int Vertex::get_rebuild_threshold() const
+{
+	// Casting will truncate. Since the theoritical result is an integer, the calculated result will be very close to an integer.
+	// The 0.5 added to the calculated result ensures that is it above the theoritical result and therefore equals to it after truncate
+	return (unsigned int)(pow(1.0+this->config->epsilon_transmission, ceil(log((double)this->size_at_building)/log(1.0+this->config->epsilon_transmission))) + 0.5);
+}
+
+unsigned int Vertex::apply_batch(const std::vector<std::pair<Point*, bool>>& updates)
+{
+	for(auto it = updates.begin(); it != updates.end(); it++)
 	{
-		Vertex* to_update;
-		if (this->pointset->get_feature_type(split_parameter) == FeatureType::REAL)
-			to_update = (*new_point)[split_parameter] <= split_threshold ? this->under_child : this->over_child;
+		if(it->second)
+			this->pointset->add_point(it->first);
 		else
-			to_update = (*new_point)[split_parameter] == split_threshold ? this->over_child : this->under_child;
-		unsigned int threshold = to_update->add_point(new_point);
-		if(threshold > 0 && this->size_at_building < threshold)
-			if(this->is_root)
-				this->build();
-			else
-				return threshold;
+			this->remove_from_pointset(it->first);
+	}
+	bool is_pending = this->pending != NULL;
+	if(is_pending)
+		for(auto it = updates.begin(); it != updates.end(); it++)
+			this->log_missed_update(it->first, it->second);
+	unsigned int threshold = this->propagate_batch(updates);
+	// The budget of a pending rebuild is given per update
+	for(size_t i = 0; i < updates.size() && is_pending && this->pending != NULL; i++)
+		this->advance_pending_rebuild();
+	return threshold;
+}
+
+void Vertex::update_concurrently(Point* point, bool is_add)
+{
+	// The vertices on which the update is counted, from this one
+	std::vector<Vertex*> path;
+	unsigned int threshold = 0;
+	unsigned int error_change = 0;
+	for(Vertex* current = this; current != NULL;)
+	{
+		std::lock_guard<std::mutex> lock(current->writers->mutex);
+		current->writers->nb_writers++;
+		path.push_back(current);
+		if(is_add)
+			current->pointset->add_point(point);
 		else
+			current->pointset->delete_point(point);
+		current->updates_since_last_build++;
+		if(current->is_root)
+			current->config->nb_root_updates++;
+		// The ancestors are marked by this loop under their own lock, hence
+		// the walk of Vertex#mark_flat_stale, and of the rebuild below, stops
+		// at the vertex
+		current->is_flat_stale = true;
+		if(current->rebuild_policy->is_rebuild_needed(*current, point, is_add))
+			threshold = current->get_rebuild_threshold();
+		else if(current->is_leaf)
 		{
-			if(threshold > 0)
-				to_update->build();
-			return 0;
+			unsigned int previous_error = current->training_error;
+			current->refresh_training_error();
+			error_change = current->training_error - previous_error;
 		}
+		current = threshold > 0 || current->is_leaf ? NULL : current->get_child_for(point->get_features());
+	}
+	if(threshold > 0)
+	{
+		// The vertex that the parents would rebuild, see Vertex#route_update.
+		// Only a rebuild modifies size_at_building, and none can be made
+		// above a vertex on which the update is counted
+		size_t rebuilt = path.size() - 1;
+		while(rebuilt > 0 && (path[rebuilt - 1]->size_at_building < threshold || (!is_add && path[rebuilt - 1]->size_at_building == threshold)))
+			rebuilt--;
+		Vertex* to_rebuild = path[rebuilt];
+		// From the bottom, as a rebuild woken up above may free the vertices
+		// below
+		for(size_t i = path.size(); i > rebuilt; i--)
+			path[i - 1]->release_writer();
+		path.resize(rebuilt);
+		std::unique_lock<std::mutex> lock(to_rebuild->writers->mutex);
+		to_rebuild->writers->no_writer.wait(lock, [to_rebuild] {return to_rebuild->writers->nb_writers == 0;});
+		// Another update may have rebuilt it meanwhile
+		if(to_rebuild->updates_since_last_build > 0)
+		{
+			unsigned int previous_error = to_rebuild->training_error;
+			to_rebuild->rebuild();
+			error_change = to_rebuild->training_error - previous_error;
+		}
+	}
+	else
+	{
+		path.back()->release_writer();
+		path.pop_back();
+	}
+	// From the bottom, so that no vertex is read once the update is not
+	// counted on it anymore. Unsigned arithmetic makes decreases wrap around
+	// as expected
+	for(auto it = path.rbegin(); it != path.rend(); it++)
+	{
+		(*it)->training_error += error_change;
+		(*it)->release_writer();
 	}
-	return 0;
 }
 
-unsigned int Vertex::delete_point(Point* old_point)
+void Vertex::release_writer()
 {
-	this->pointset->delete_point(old_point);
-	this->updates_since_last_build++;
-	if(this->updates_since_last_build >= epsilon*this->size_at_building)
-	{
-		if(this->is_root)
-			this->build();
+	if(--this->writers->nb_writers > 0)
+		return;
+	// The waiting rebuild holds the mutex until it waits, hence it can not
+	// miss the notification
+	std::lock_guard<std::mutex> lock(this->writers->mutex);
+	this->writers->no_writer.notify_all();
+}
+
+unsigned int Vertex::propagate_batch(const std::vector<std::pair<Point*, bool>>& updates)
+{
+	this->updates_since_last_build += (unsigned int)updates.size();
+	if(this->is_root)
+		this->config->nb_root_updates += updates.size();
+	if(this->is_leaf)
+		this->mark_flat_stale();
+	// The subtree of a dirty vertex is rebuilt from its pointset when read
+	if(this->is_dirty)
+		return 0;
+	unsigned int threshold = this->deferred_threshold;
+	this->deferred_threshold = 0;
+	bool is_rebuild_needed = this->pending == NULL && this->rebuild_policy->is_batch_rebuild_needed(*this, updates);
+	if(is_rebuild_needed)
+		threshold = this->get_rebuild_threshold();
 
-		// Casting will truncate. Since the theoritical result is an integer, the calculated result will be very close to an integer.
-		// The 0.5 added to the calculated result ensures that is it above the theoritical result and therefore equals to it after truncate
-		return (unsigned int)(pow(1.0+epsilon_transmission, ceil(log((double)this->size_at_building)/log(1.0+epsilon_transmission))) + 0.5);
+	// See Vertex#propagate_update
+	if(!this->is_leaf && (this->pending != NULL || (is_rebuild_needed && this->is_rebuild_deferred())))
+	{
+		for(auto it = updates.begin(); it != updates.end(); it++)
+			this->route_without_rebuild(it->first, it->second);
 	}
-	else if(!this->is_leaf)
+	else if(!this->is_leaf && !is_rebuild_needed)
 	{
-		Vertex* to_update;
-		if(this->pointset->get_feature_type(split_parameter) == FeatureType::REAL)
-			to_update = (*old_point)[split_parameter] <= split_threshold ? this->under_child : this->over_child;
+		if(this->config->buffer_size == 0)
+			threshold = std::max(threshold, this->route_batch(updates));
 		else
-			to_update = (*old_point)[split_parameter] == split_threshold ? this->over_child : this->under_child;
-		unsigned int threshold = to_update->delete_point(old_point);
-		if(threshold > 0 && this->size_at_building <= threshold)
-			if(this->is_root)
-				this->build();
-			else
-				return threshold;
+		{
+			for(auto it = updates.begin(); it != updates.end(); it++)
+				this->buffer_update(it->first, it->second);
+			if(this->buffer.size() >= this->config->buffer_size)
+				threshold = std::max(threshold, this->apply_buffer());
+		}
+	}
+
+	if(threshold > 0 && this->is_root) // If is root, parent can not call rebuild
+		this->rebuild();
+	this->refresh_uniform();
+	this->refresh_training_error();
+	return threshold;
+}
+
+unsigned int Vertex::route_batch(const std::vector<std::pair<Point*, bool>>& updates)
+{
+	std::vector<std::pair<Point*, bool>> child_updates[2];
+	for(auto it = updates.begin(); it != updates.end(); it++)
+		child_updates[this->get_child_for(it->first->get_features()) == this->under_child ? 0 : 1].push_back(*it);
+	Vertex* children[2] = {this->under_child, this->over_child};
+	unsigned int child_thresholds[2] = {0, 0};
+	if(!child_updates[0].empty() && !child_updates[1].empty() && this->is_above_parallel_depth())
+	{
+		// The updates of the subtrees mark their ancestors, marking them
+		// beforehand makes them stop below this vertex
+		this->mark_flat_stale();
+		if(this->config->is_lazy)
+			this->mark_flush_needed();
+		std::future<unsigned int> under_threshold = std::async(std::launch::async, [children, &child_updates]()
+			{return children[0]->apply_batch(child_updates[0]);});
+		child_thresholds[1] = children[1]->apply_batch(child_updates[1]);
+		child_thresholds[0] = under_threshold.get();
+	}
+	else
+		for(int i = 0; i < 2; i++)
+			if(!child_updates[i].empty())
+				child_thresholds[i] = children[i]->apply_batch(child_updates[i]);
+
+	unsigned int threshold = 0;
+	for(int i = 0; i < 2; i++)
+	{
+		if(child_thresholds[i] == 0)
+			continue;
+		bool is_deletion_only = std::none_of(child_updates[i].begin(), child_updates[i].end(), [](const std::pair<Point*, bool>& update) {return update.second;});
+		if(this->size_at_building < child_thresholds[i] || (is_deletion_only && this->size_at_building == child_thresholds[i]))
+			threshold = std::max(threshold, child_thresholds[i]);
 		else
+			children[i]->rebuild();
+	}
+	return threshold;
+}
+
+bool Vertex::is_above_parallel_depth() const
+{
+	unsigned int depth = 0;
+	for(Vertex* vertex = this->parent; vertex != NULL && depth < this->config->parallel_depth; vertex = vertex->parent)
+		depth++;
+	return depth < this->config->parallel_depth;
+}
+
+void Vertex::buffer_update(Point* point, bool is_add)
+{
+	for(auto it = this->buffer.rbegin(); it != this->buffer.rend(); it++)
+		if(it->first == point && it->second != is_add)
 		{
-			if(threshold > 0)
-				to_update->build();
-			return 0;
+			if(!it->second)
+				this->config->nb_buffered_deletions--;
+			this->buffer.erase(std::next(it).base());
+			if(this->buffer.empty())
+				this->mark_flat_stale();
+			return;
 		}
+	if(this->buffer.empty())
+	{
+		this->mark_flush_needed();
+		this->mark_flat_stale();
 	}
-	return 0;
+	this->buffer.push_back(std::make_pair(point, is_add));
+	if(!is_add)
+		this->config->nb_buffered_deletions++;
+}
+
+unsigned int Vertex::apply_buffer()
+{
+	// A point appears at most once in the buffer, hence the updates of
+	// different points can be reordered
+	std::vector<std::pair<Point*, bool>> to_apply;
+	to_apply.swap(this->buffer);
+	this->mark_flat_stale();
+	std::stable_partition(to_apply.begin(), to_apply.end(), [this](const std::pair<Point*, bool>& update)
+		{return this->get_child_for(update.first->get_features()) == this->under_child;});
+	unsigned int threshold = 0;
+	for(auto it = to_apply.begin(); it != to_apply.end(); it++)
+	{
+		if(!it->second)
+			this->config->nb_buffered_deletions--;
+		threshold = std::max(threshold, this->route_update(it->first, it->second));
+	}
+	this->refresh_uniform();
+	this->refresh_training_error();
+	return threshold;
+}
+
+void Vertex::flush_buffer()
+{
+	this->deferred_threshold = std::max(this->deferred_threshold, this->apply_buffer());
+	if(this->is_root && this->deferred_threshold > 0)
+	{
+		this->deferred_threshold = 0;
+		this->rebuild();
+	}
+}
+
+void Vertex::refresh_uniform()
+{
+	if(!this->config->use_pruning)
+		return;
+	bool was_uniform = this->is_uniform;
+	bool previous_decision = this->uniform_decision;
+	if(this->is_leaf)
+	{
+		this->is_uniform = !this->is_dirty;
+		this->uniform_decision = this->pointset->get_positive_proportion() >= 0.5;
+	}
+	else
+	{
+		this->is_uniform = !this->is_dirty && this->buffer.empty()
+			&& this->under_child->is_uniform && this->over_child->is_uniform
+			&& this->under_child->uniform_decision == this->over_child->uniform_decision;
+		this->uniform_decision = this->under_child->uniform_decision;
+	}
+	if(this->is_uniform != was_uniform || (this->is_uniform && this->uniform_decision != previous_decision))
+		this->mark_flat_stale();
+}
+
+void Vertex::mark_flush_needed()
+{
+	for(Vertex* vertex = this; vertex != NULL && !vertex->is_flush_needed; vertex = vertex->parent)
+		vertex->is_flush_needed = true;
+}
+
+void Vertex::refresh_training_error()
+{
+	if(this->is_leaf)
+		this->training_error = this->pointset->get_training_error();
+	else
+		this->training_error = this->under_child->training_error + this->over_child->training_error;
+}
+
+void Vertex::refresh_training_error_subtree()
+{
+	if(!this->is_leaf)
+	{
+		this->under_child->refresh_training_error_subtree();
+		this->over_child->refresh_training_error_subtree();
+	}
+	this->refresh_training_error();
+}
+
+void Vertex::mark_flat_stale()
+{
+	for(Vertex* vertex = this; vertex != NULL && !vertex->is_flat_stale; vertex = vertex->parent)
+		vertex->is_flat_stale = true;
+}
+
+void Vertex::refresh_uniform_subtree()
+{
+	if(!this->is_leaf)
+	{
+		this->under_child->refresh_uniform_subtree();
+		this->over_child->refresh_uniform_subtree();
+	}
+	this->refresh_uniform();
+}
+
+void Vertex::clear_buffer()
+{
+	for(auto it = this->buffer.begin(); it != this->buffer.end(); it++)
+		if(!it->second)
+			this->config->nb_buffered_deletions--;
+	if(!this->buffer.empty())
+		this->mark_flat_stale();
+	this->buffer.clear();
+}
+
+void Vertex::remove_from_pointset(Point* old_point)
+{
+	if(this->config->use_tombstones)
+	{
+		this->pointset->mark_deleted(old_point);
+		this->config->nb_tombstones++;
+	}
+	else
+		this->pointset->delete_point(old_point);
+}
+
+void Vertex::purge_pointset()
+{
+	this->config->nb_tombstones -= this->pointset->get_nb_tombstones();
+	this->pointset->purge();
+}
+
+void Vertex::free_pointset()
+{
+	if(this->pointset == NULL)
+		return;
+	this->config->nb_tombstones -= this->pointset->get_nb_tombstones();
+	delete this->pointset;
+	this->pointset = NULL;
+}
+
+Vertex* Vertex::get_child_for(const float* features)
+{
+	if (this->pointset->get_feature_type(split_parameter) == FeatureType::REAL)
+		return features[split_parameter] <= split_threshold ? this->under_child : this->over_child;
+	else if(this->split_categories != 0)
+		return PointSet::is_in_categories(this->split_categories, features[split_parameter]) ? this->over_child : this->under_child;
+	else
+		return features[split_parameter] == split_threshold ? this->over_child : this->under_child;
 }
 
 bool Vertex::decision(const float* features)
 {
+	if(!this->is_dirty && !this->buffer.empty())
+		this->flush_buffer();
+	if(this->is_dirty)
+		this->build();
+	if(this->config->use_pruning && this->is_uniform)
+		return this->uniform_decision;
 	if(this->is_leaf)
 		return this->pointset->get_positive_proportion() >= 0.5;
 	else
 	{
-		Vertex* decision_vertex;
-		if (this->pointset->get_feature_type(split_parameter) == FeatureType::REAL)
-			decision_vertex = features[split_parameter] <= split_threshold ? this->under_child : this->over_child;
-		else
-			decision_vertex = features[split_parameter] == split_threshold ? this->over_child : this->under_child;
-		return decision_vertex->decision(features);
+		return this->get_child_for(features)->decision(features);
 	}
 }
 
@@ -207,7 +1184,17 @@ std::vector<std::string> Vertex::to_string()
 	}
 	else
 	{
-		std::string basis = "f=" + std::to_string(this->split_parameter) + ";t=" + std::to_string(this->split_threshold) + ";p=" + std::to_string(this->pointset->get_positive_proportion())+ ";s=" + std::to_string(this->pointset->get_size());
+		std::string threshold_str;
+		if(this->split_categories == 0)
+			threshold_str = std::to_string(this->split_threshold);
+		else
+		{
+			for(unsigned int category = 0; category < PointSet::MAX_SUBSET_CATEGORIES; category++)
+				if(PointSet::is_in_categories(this->split_categories, category))
+					threshold_str += (threshold_str.empty() ? "{" : ",") + std::to_string(category);
+			threshold_str += "}";
+		}
+		std::string basis = "f=" + std::to_string(this->split_parameter) + ";t=" + threshold_str + ";p=" + std::to_string(this->pointset->get_positive_proportion())+ ";s=" + std::to_string(this->pointset->get_size());
 		std::vector<std::string> to_return = this->over_child->to_string();
 		std::string it_over_str = std::string(basis.length()-1, ' ') + "|  " ;
 		auto it_over = to_return.begin();
@@ -224,10 +1211,74 @@ std::vector<std::string> Vertex::to_string()
 	}
 }
 
-unsigned int Vertex::get_training_error()
+/**
+ * Write a float as a C++ literal giving back the same value
+ *
+ * @param out The stream to write the literal into
+ * @param value The value to write
+ */
+static void write_float_literal(std::ostream& out, float value)
 {
-	if(this->is_leaf)
-		return this->pointset->get_training_error();
+	if(std::isnan(value))
+		out << "std::numeric_limits<float>::quiet_NaN()";
+	else if(std::isinf(value))
+		out << (value < 0 ? "-" : "") << "std::numeric_limits<float>::infinity()";
+	else
+	{
+		// The point keeps integer values from being read as int literals
+		std::ios_base::fmtflags previous_flags = out.flags();
+		std::streamsize previous_precision = out.precision(std::numeric_limits<float>::max_digits10);
+		out << std::showpoint << value << "f";
+		out.precision(previous_precision);
+		out.flags(previous_flags);
+	}
+}
+
+void Vertex::export_cpp(std::ostream& out, unsigned int depth)
+{
+	std::string indent(depth, '\t');
+	if(this->config->use_pruning && this->is_uniform)
+		out << indent << "return " << (this->uniform_decision ? "true" : "false") << ";\n";
+	else if(this->is_leaf)
+		out << indent << "return " << (this->pointset->get_positive_proportion() >= 0.5 ? "true" : "false") << ";\n";
 	else
-		return this->under_child->get_training_error() + this->over_child->get_training_error();
+	{
+		// The condition is written as in Vertex#get_child_for, so that NaN
+		// features are routed the same way
+		std::string feature = "features[" + std::to_string(this->split_parameter) + "]";
+		Vertex* if_child;
+		Vertex* else_child;
+		out << indent << "if(";
+		if (this->pointset->get_feature_type(split_parameter) == FeatureType::REAL)
+		{
+			out << feature << " <= ";
+			write_float_literal(out, this->split_threshold);
+			if_child = this->under_child;
+			else_child = this->over_child;
+		}
+		else if(this->split_categories != 0)
+		{
+			out << feature << " >= 0 && " << feature << " < " << PointSet::MAX_SUBSET_CATEGORIES
+				<< " && ((" << this->split_categories << "ULL >> (unsigned int)" << feature << ") & 1)";
+			if_child = this->over_child;
+			else_child = this->under_child;
+		}
+		else
+		{
+			out << feature << " == ";
+			write_float_literal(out, this->split_threshold);
+			if_child = this->over_child;
+			else_child = this->under_child;
+		}
+		out << ")\n" << indent << "{\n";
+		if_child->export_cpp(out, depth + 1);
+		out << indent << "}\n" << indent << "else\n" << indent << "{\n";
+		else_child->export_cpp(out, depth + 1);
+		out << indent << "}\n";
+	}
+}
+
+unsigned int Vertex::get_training_error()
+{
+	return this->training_error;
 }
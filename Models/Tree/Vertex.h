@@ -7,7 +7,19 @@
 
 #include "../PointSet/PointSet.h"
 #include "../PointSet/Point.h"
+#include "RebuildPolicy.h"
+#include "TreeConfig.h"
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
 
 /**
  * Count the number of calls to the build method
@@ -16,26 +28,22 @@
  */
 extern unsigned int nb_build; 
 
+class FlatTree;
+
 /**
  * A Vertex of the tree
  *
  * This class represents a vertex of the tree, and hence deals with relations
- * with parents and children vertices.
+ * with parents and children vertices. The settings of the tree are kept in
+ * its TreeConfig, and the vertices are allocated in its VertexArena, while
+ * the data they own, such as their pointset, is allocated on the heap.
  */
 class Vertex {
+	friend class FlatTree;
+
 	private:
-		/**
-		 * Indicates whether this vertex is a leaf
-		 *
-		 * This vertex should have two children iif this is false.
-		 */
-		bool is_leaf;
-		/**
-		 * Indicates whether this vertex is the root (top vertex) of the tree
-		 *
-		 * This vertex should have a parent vertex iif this is false
-		 */
-		bool is_root;
+		// The fields read by a walk come first, so that they share a cache
+		// line (see VertexArena)
 
 		/**
 		 * Index of the feature along which split is performed
@@ -47,7 +55,7 @@ class Vertex {
 		 * @note When {@link #is_leaf this->is_leaf} is true, this parameter is
 		 * 	not relevant and could be uninitialized
 		 */
-		size_t split_parameter;
+		uint32_t split_parameter;
 
 		/**
 		 * Index of the splitting threshold
@@ -67,6 +75,89 @@ class Vertex {
 		 */
 		float split_threshold;
 
+		/**
+		 * Indicates whether this vertex is a leaf
+		 *
+		 * This vertex should have two children iif this is false.
+		 */
+		bool is_leaf;
+
+		/**
+		 * Indicates whether the vertex should be built before being read
+		 *
+		 * The pointset of a dirty vertex is kept up to date, but its split and
+		 * children are not, and updates are not propagated to them.
+		 */
+		bool is_dirty;
+
+		/**
+		 * Indicates whether all the leaves of the subtree give the same
+		 * decision, which is then {@link #uniform_decision uniform_decision}
+		 *
+		 * This is only maintained when TreeConfig#use_pruning is true. A
+		 * dirty vertex, or a vertex with buffered updates, is never uniform,
+		 * so that decisions still go through it.
+		 */
+		bool is_uniform;
+
+		/// Decision given by all the leaves of a uniform subtree
+		bool uniform_decision;
+
+		/**
+		 * Categories of the right leg, for a subset split
+		 *
+		 * If not 0, the split is along a classified feature and points go in
+		 * the right leg iif their category belongs in this bitmask, in which
+		 * case {@link #split_threshold split_threshold} is not relevant.
+		 *
+		 * @see PointSet#is_in_categories
+		 */
+		uint64_t split_categories;
+
+		/**
+		 * The left leg child vertex of this one
+		 *
+		 * @note Vertices are owned by their parents, and the root vertex is
+		 *	owned by the tree, hence this pointer is owned by this vertex
+		 */
+		Vertex* under_child;
+
+		/**
+		 * The right leg child vertex of this one
+		 *
+		 * @note Vertices are owned by their parents, and the root vertex is
+		 *	owned by the tree, hence this pointer is owned by this vertex
+		 */
+		Vertex* over_child;
+
+		/// The Pointset containing the points of this vertex
+		PointSet* pointset;
+
+		/**
+		 * The parent vertex of this one
+		 * 
+		 * This is the vertex that created this one, it will be NULL if
+		 * {@link #is_root this->is_root} is true.
+		 *
+		 * @note Vertices are owned by their parents, and the root vertex is
+		 *	owned by the tree, hence this pointer is not owned by this vertex
+		 */
+		Vertex* parent;
+
+		/**
+		 * Settings of the tree this vertex belongs to
+		 *
+		 * @note This is owned by the tree
+		 */
+		TreeConfig* config;
+
+		/**
+		 * Indicates whether this vertex is the root (top vertex) of the tree
+		 *
+		 * This vertex should have a parent vertex iif this is false
+		 */
+		bool is_root;
+
 		/**
 		 * Indicate the number of children layers that can still be added
 		 *
@@ -86,74 +177,217 @@ class Vertex {
 		unsigned int size_at_building;
 
 		/**
-		 * Parameter of the algorithm, used for deciding when to rebuild
+		 * Number of updates the last build is certified to survive
+		 *
+		 * Computed on build from the margins of the conditions that decided
+		 * the vertex : the gain margin between the chosen split and the
+		 * runner-up, and the distances to min_split_points, min_split_gini
+		 * and to a null gain. A single update changes the size-weighted gini
+		 * and gains by less than 4, hence the outcome of the build can not
+		 * change before that many updates.
+		 *
+		 * @note Only the split of this vertex is certified, the children keep
+		 * 	their own certificate
+		 */
+		unsigned int certified_updates;
+
+		/**
+		 * Policy deciding when to rebuild this vertex
 		 *
-		 * Higher epsilon value leads to more frequent rebuild and hence more
-		 * precise predictions, but also higher computation time. 
+		 * This is kept by each vertex, as a policy may keep statistics of the
+		 * vertex.
 		 *
-		 * If epsilon=0, the whole tree will be rebuild at each update.
-		 */		 
-		float epsilon;
+		 * @note This is owned by the vertex
+		 */
+		RebuildPolicy* rebuild_policy;
 
-		/// Minimal number of points in the pointset to allow splitting
-		unsigned int min_split_points;
+		/**
+		 * Updates not propagated to the children yet
+		 *
+		 * Each point appears at most once : an update cancels the opposite
+		 * update of the same point if it is still buffered.
+		 *
+		 * @see TreeConfig#buffer_size
+		 */
+		std::vector<std::pair<Point*, bool>> buffer;
 
-		/// Minimal gini value of the pointset to allow splitting
-		float min_split_gini;
+		/**
+		 * Rebuild threshold obtained while flushing the buffer outside of an
+		 * update, returned by the next update
+		 */
+		unsigned int deferred_threshold;
 
 		/**
-		 * Epsilon value to use when figuring out which vertex to recompute
+		 * Epsilon used by the rebuild rule of this vertex
 		 *
-		 * Epsilon is used twice in the algorithm : once to decide whether the
-		 * vertex should be recalculated, and a second time when it has been
-		 * decided that the vertex should be recalculated, which parent of the
-		 * vertex or the vertex itself should be recalculate (see the paper for
-		 * more details). This parameter allow to have a different value of
-		 * epsilon for the second purpose.
+		 * This is TreeConfig#epsilon unless an update time budget is set, in
+		 * which case it lies between TreeConfig#epsilon and
+		 * TreeConfig#epsilon_max. A vertex created by a build starts from the
+		 * epsilon of its parent.
+		 */
+		float adapted_epsilon;
+
+		/// Time of the last build of the subtree per point, in ms
+		double build_time_per_point;
+
+		/// Value of TreeConfig#nb_root_updates on the last build
+		unsigned long root_updates_at_building;
+
+		/**
+		 * Training error of the subtree
+		 *
+		 * This is maintained on the update path and on builds, hence
+		 * reading it is O(1). It is not relevant below a dirty vertex, nor
+		 * while updates are buffered above the leaves, see Vertex#flush.
 		 *
-		 * @note In most of the cases, this is expected to be equal to
-		 *		1, although the implementation is able to handle different value
+		 * It is atomic as concurrent writers add the changes of the leaves
+		 * they update to the vertices above without locking them.
+		 *
+		 * @see Vertex#get_training_error
+		 * @see Vertex#update_concurrently
 		 */
-		float epsilon_transmission;
+		std::atomic<unsigned int> training_error;
 
 		/**
-		 * The parent vertex of this one
-		 * 
-		 * This is the vertex that created this one, it will be NULL if
-		 * {@link #is_root this->is_root} is true.
+		 * Indicates whether this vertex or one of its descendants is dirty or
+		 * has buffered updates
 		 *
-		 * @note Vertices are owned by their parents, and the root vertex is
-		 *	owned by the tree, hence this pointer is not owned by this vertex
+		 * When this is true, so is it for all the ancestors. It may stay true
+		 * after the vertices have been brought up to date by a decision, until
+		 * the next Vertex#flush.
 		 */
-		Vertex* parent;
+		bool is_flush_needed;
 
 		/**
-		 * The left leg child vertex of this one
+		 * Indicates whether the node of this vertex, or of one of its
+		 * descendants, should be written again in the FlatTree
 		 *
-		 * @note Vertices are owned by their parents, and the root vertex is
-		 *	owned by the tree, hence this pointer is owned by this vertex
+		 * When a vertex is marked stale, so are all its ancestors.
+		 *
+		 * @see Vertex#mark_flat_stale
 		 */
-		Vertex* under_child;
+		bool is_flat_stale;
 
 		/**
-		 * The right leg child vertex of this one
+		 * Index of the node of this vertex in the FlatTree of its tree
 		 *
-		 * @note Vertices are owned by their parents, and the root vertex is
-		 *	owned by the tree, hence this pointer is owned by this vertex
+		 * This is only relevant if the node of the parent references it.
 		 */
-		Vertex* over_child;
+		unsigned int flat_index;
 
-		/// The Pointset containing the points of this vertex
-		PointSet* pointset;
+		/// States of a build made by a background thread
+		enum class background_state {
+			/// The build is in progress
+			RUNNING,
+			/// The build is complete and the shadow can be swapped in
+			DONE,
+			/// The rebuild has been cancelled, the thread frees the shadow
+			CANCELLED
+		};
 
-		static unsigned int nb_build;
+		/**
+		 * Data shared between a vertex and the thread rebuilding it
+		 *
+		 * The background thread builds the shadow subtree, then replays the
+		 * missed updates onto it until it catches up with the updates logged
+		 * by the vertex.
+		 */
+		struct background_build {
+			/// Protects all the other attributes
+			std::mutex mutex;
+			/// State of the build
+			background_state state;
+			/// Notified when the state becomes DONE
+			std::condition_variable is_done;
+			/**
+			 * Updates received by the vertex since the snapshot, in order
+			 *
+			 * The boolean is true for an insertion, false for a deletion.
+			 */
+			std::vector<std::pair<Point*, bool>> missed_updates;
+			/// Number of missed_updates replayed by the background thread
+			size_t nb_replayed;
+		};
+
+		/**
+		 * A rebuild of the vertex made in several steps
+		 *
+		 * The shadow subtree is built on a snapshot of the pointset of the
+		 * vertex. The updates received since the snapshot are logged, and
+		 * replayed onto the shadow subtree once it is built.
+		 */
+		struct pending_rebuild {
+			/**
+			 * Root of the subtree being built
+			 *
+			 * @note This is owned by the pending_rebuild
+			 */
+			Vertex* shadow;
+			/// Vertices of the shadow subtree of which build is not complete
+			std::deque<Vertex*> to_build;
+			/**
+			 * Updates received since the snapshot, in order
+			 *
+			 * The boolean is true for an insertion, false for a deletion. For a
+			 * build in background, the updates are logged in
+			 * {@link #background background} until the thread completes.
+			 */
+			std::vector<std::pair<Point*, bool>> missed_updates;
+			/// Number of missed_updates already replayed onto the shadow
+			size_t nb_replayed;
+			/**
+			 * Data shared with the thread building the shadow in background
+			 *
+			 * NULL when the shadow is built in steps by the updates.
+			 */
+			std::shared_ptr<background_build> background;
+		};
+
+		/**
+		 * The rebuild of this vertex in progress, if any
+		 *
+		 * NULL if there is no pending rebuild.
+		 *
+		 * @note This is owned by the vertex
+		 */
+		pending_rebuild* pending;
+
+		/**
+		 * Synchronization of the threads updating the vertex concurrently
+		 *
+		 * @see Vertex#update_concurrently
+		 */
+		struct writer_lock {
+			/// Protects the vertex and its pointset
+			std::mutex mutex;
+			/**
+			 * Number of updates in progress that went through the vertex
+			 *
+			 * This is increased with the mutex held, hence once it is 0 with
+			 * the mutex held, no update is in the subtree and none can enter
+			 * it.
+			 */
+			std::atomic<unsigned int> nb_writers;
+			/// Notified when {@link #nb_writers nb_writers} drops to 0
+			std::condition_variable no_writer;
+		};
+
+		/**
+		 * Lock of the vertex for concurrent writers
+		 *
+		 * NULL unless TreeConfig#use_concurrent_writers is true.
+		 *
+		 * @note This is owned by the vertex
+		 */
+		writer_lock* writers;
+
+		static std::atomic<unsigned int> nb_build;
 
 		/**
 		 * Enhanced copy constuctor of Vertex
 		 *
 		 * Copy the parameters of source except its parent and pointset, which
-		 * are provided separately. The epsilon and epsilon_transmission are
-		 * copied from parent.
+		 * are provided separately. The vertex belongs to the tree of parent.
 		 * 
 		 * This function is meant to avoid recomputing the inital tree when
 		 * making several tests
@@ -166,6 +400,313 @@ class Vertex {
 		 */
 		Vertex(const Vertex& source, Vertex* parent, PointSet* pointset);
 
+		/**
+		 * Constructor of a vertex which is not built yet
+		 *
+		 * The vertex belongs to the tree of @p model, whose rebuild policy is
+		 * cloned, and starts from its epsilon and build time per point. The
+		 * vertex is a leaf until its build is completed by
+		 * Vertex#advance_build.
+		 *
+		 * @param pointset The pointset of the new vertex. Ownership is taken
+		 * @param model The vertex from which the tree and policy are taken
+		 * @param parent The parent vertex of the new vertex
+		 * @param remaining_high The number of children layers that can still
+		 * 	be added
+		 */
+		Vertex(PointSet* pointset, const Vertex& model, Vertex* parent, unsigned int remaining_high);
+
+		/**
+		 * Start a build of the vertex
+		 *
+		 * Reset the data related to the last build and free memory of the
+		 * children.
+		 */
+		void begin_build();
+
+		/**
+		 * Complete a build of the vertex
+		 *
+		 * Decide whether the vertex should be a leaf and, if not, split the
+		 * pointset to make the two children.
+		 *
+		 * @param is_deferred If true, the children are created without being
+		 * 	built
+		 */
+		void end_build(bool is_deferred);
+
+		/**
+		 * Advance the build of a vertex created without being built
+		 *
+		 * @param budget In/out argument, the number of point-operations
+		 * 	allowed, decreased by the number of operations made
+		 * @return true if the build of this vertex is complete. Its children,
+		 * 	if any, are not built yet
+		 */
+		bool advance_build(unsigned long& budget);
+
+		/**
+		 * Tune {@link #adapted_epsilon adapted_epsilon} before a rebuild
+		 *
+		 * The time of the last build and the share of the updates of the tree
+		 * that went through this vertex since then give the rebuild time
+		 * spent per root update. The epsilon is chosen so that this time
+		 * matches TreeConfig#update_time_budget.
+		 */
+		void adapt_epsilon();
+
+		/**
+		 * Rebuild the vertex, at once, in several steps or in background
+		 *
+		 * Depending on TreeConfig#async_min_size and TreeConfig#rebuild_budget,
+		 * either build the vertex or start a pending rebuild if none is in
+		 * progress. Nothing is done if an ancestor has a pending rebuild.
+		 */
+		void rebuild();
+
+		/**
+		 * Indicates whether Vertex#rebuild would start a pending rebuild of
+		 * this vertex instead of building it at once
+		 *
+		 * @note A lazy rebuild is not deferred: the subtree is rebuilt from
+		 * 	the pointset when read
+		 */
+		bool is_rebuild_deferred() const;
+
+		/**
+		 * Advance the pending rebuild
+		 *
+		 * A rebuild in steps is advanced by TreeConfig#rebuild_budget
+		 * point-operations. A rebuild in background is checked
+		 * for completion. When the shadow subtree is built and all the missed
+		 * updates have been replayed, it replaces the current subtree.
+		 *
+		 * Past TreeConfig#max_pending_lag, the rebuild is completed at once,
+		 * waiting for the background thread if needed.
+		 */
+		void advance_pending_rebuild();
+
+		/**
+		 * Log an update received while a rebuild is pending
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 */
+		void log_missed_update(Point* point, bool is_add);
+
+		/**
+		 * Build a shadow subtree and replay the missed updates onto it
+		 *
+		 * This is the function run by the background thread. When the replay
+		 * stops catching up with the updates, the build is marked done and
+		 * the remaining updates are replayed by Vertex#advance_pending_rebuild.
+		 *
+		 * @param shadow The root of the subtree to build, freed by this
+		 * 	function if the rebuild is cancelled
+		 * @param background The data shared with the rebuilt vertex
+		 */
+		static void build_in_background(Vertex* shadow, std::shared_ptr<background_build> background);
+
+		/**
+		 * Free memory of the pending rebuild, if any
+		 *
+		 * @note If the rebuild is made in background and not complete, the
+		 * 	background thread frees the shadow subtree when it completes
+		 */
+		void cancel_pending_rebuild();
+
+		/**
+		 * Count an update and propagate it to the children
+		 *
+		 * This is the decision making part common to Vertex#add_point and
+		 * Vertex#delete_point, once the pointset of this vertex has been
+		 * updated.
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 * @return The rebuild threshold, see Vertex#add_point
+		 */
+		unsigned int propagate_update(Point* point, bool is_add);
+
+		/**
+		 * Propagate an update to the child it belongs to
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 * @return The rebuild threshold to transmit to the parent, or 0 if the
+		 * 	child did not need a rebuild or has been rebuilt
+		 */
+		unsigned int route_update(Point* point, bool is_add);
+
+		/**
+		 * Add or remove a point in the subtree, without rebuilding any vertex
+		 *
+		 * This is used for the subtrees that are about to be replaced, which
+		 * keep making decisions until then, and for replaying the missed
+		 * updates onto a shadow subtree. The counters are updated, hence the
+		 * rebuild rule applies again to the shadow subtree once it is swapped
+		 * in, as if it had been built at once. The pending rebuilds of the
+		 * subtree are cancelled, and the buffered updates are applied first.
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 */
+		void update_without_rebuild(Point* point, bool is_add);
+
+		/**
+		 * Propagate an update to the child it belongs to, without rebuilding
+		 * any vertex
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 * @see Vertex#update_without_rebuild
+		 */
+		void route_without_rebuild(Point* point, bool is_add);
+
+		/// Indicates whether an ancestor has a pending rebuild, which will replace this vertex
+		bool is_replaced_by_pending_rebuild() const;
+
+		/**
+		 * Rebuild threshold to transmit to the parent when this vertex needs
+		 * to be rebuilt
+		 *
+		 * This is the smallest power of (1+epsilon_transmission) not below
+		 * the size of the vertex at building.
+		 */
+		unsigned int get_rebuild_threshold() const;
+
+		/**
+		 * Count a batch of updates and propagate it to the children
+		 *
+		 * This is the counterpart of Vertex#propagate_update for
+		 * Vertex#apply_batch: the rebuild rule is checked once for the whole
+		 * batch.
+		 *
+		 * @param updates The points added (true) or removed (false), not empty
+		 * @return The rebuild threshold, see Vertex#add_point
+		 */
+		unsigned int propagate_batch(const std::vector<std::pair<Point*, bool>>& updates);
+
+		/**
+		 * Propagate a batch of updates to the children they belong to
+		 *
+		 * Each child receives its part of the batch at once, and is rebuilt at
+		 * most once. Above TreeConfig#parallel_depth, the two children are
+		 * updated by different threads, then rebuilt by this one.
+		 *
+		 * @param updates The points added (true) or removed (false)
+		 * @return The rebuild threshold to transmit to the parent, or 0 if the
+		 * 	children did not need a rebuild or have been rebuilt
+		 */
+		unsigned int route_batch(const std::vector<std::pair<Point*, bool>>& updates);
+
+		/// Indicates whether the vertex is less deep than TreeConfig#parallel_depth
+		bool is_above_parallel_depth() const;
+
+		/**
+		 * Add an update to {@link #buffer buffer}
+		 *
+		 * If the opposite update of the same point is buffered, both cancel
+		 * out.
+		 *
+		 * @param point The point added or removed
+		 * @param is_add True if the point is added, false if it is removed
+		 */
+		void buffer_update(Point* point, bool is_add);
+
+		/**
+		 * Propagate all the buffered updates to the children
+		 *
+		 * The updates are grouped by child, so that each child receives its
+		 * updates in a row.
+		 *
+		 * @return The highest rebuild threshold to transmit to the parent
+		 */
+		unsigned int apply_buffer();
+
+		/**
+		 * Apply the buffer outside of an update
+		 *
+		 * The rebuild threshold obtained is kept in
+		 * {@link #deferred_threshold deferred_threshold}, except for the root
+		 * which is rebuilt at once.
+		 */
+		void flush_buffer();
+
+		/// Drop the buffered updates, whose points are already in the pointset
+		void clear_buffer();
+
+		/**
+		 * Remove a point from the pointset, or only mark it as deleted if
+		 * TreeConfig#use_tombstones is true
+		 *
+		 * @param old_point The point to remove
+		 */
+		void remove_from_pointset(Point* old_point);
+
+		/// Remove the points marked as deleted from the pointset, see PointSet#purge
+		void purge_pointset();
+
+		/// Free memory of the pointset, if any
+		void free_pointset();
+
+		/**
+		 * Compute {@link #is_uniform is_uniform} from the children
+		 *
+		 * This does nothing unless TreeConfig#use_pruning is true.
+		 */
+		void refresh_uniform();
+
+		/// Compute {@link #is_uniform is_uniform} for the whole subtree
+		void refresh_uniform_subtree();
+
+		/// Set {@link #is_flush_needed is_flush_needed} for this vertex and its ancestors
+		void mark_flush_needed();
+
+		/**
+		 * Compute {@link #training_error training_error} from the pointset
+		 * for a leaf, or from the children
+		 */
+		void refresh_training_error();
+
+		/// Compute {@link #training_error training_error} for the whole subtree
+		void refresh_training_error_subtree();
+
+		/**
+		 * Mark this vertex and its ancestors as {@link #is_flat_stale stale}
+		 *
+		 * This should be called whenever the decisions given by the vertex
+		 * may change for another reason than a change of its children.
+		 */
+		void mark_flat_stale();
+
+		/**
+		 * Get the child in which features would go
+		 *
+		 * @param features The features of the point to route
+		 * @warning The vertex should not be a leaf
+		 */
+		Vertex* get_child_for(const float* features);
+
+		/**
+		 * Compute {@link #certified_updates certified_updates}
+		 *
+		 * This is meant to be called at the end of a build, when the leaf
+		 * status and the split have just been decided.
+		 */
+		void compute_certificate();
+
+		/**
+		 * Destructor of Vertex
+		 *
+		 * Free memory of children
+		 *
+		 * @note This is private, as the memory of the vertex belongs to the
+		 * 	arena of its tree, see Vertex#destroy
+		 */
+		~Vertex();
+
+
 	public:
 		/**
 		 * Main constructor of Vertex
@@ -179,25 +720,8 @@ class Vertex {
 		 * 	added.
 		 * 	This corresponds to the parameter h of the algorithm, minus the
 		 * 	number of ancesters of this vertex +1 (to include this vertex).
-		 * @param epsilon The epsilon parameter of the algorithm. Please note
-		 *	that this parameter is splitted in two since there is also the
-		 *	epsilon_transmission parameter, which is however expected to be
-		 *	equal to epsilon most of the time
-		 * @param min_split_points Minimal number of points in the pointset to
-		 *	allow splitting
-		 * @param min_split_gini Minimal gini value of the pointset to allow
-		 *	splitting
-		 * @param epsilon_transmission Epsilon value to use when figuring out
-		 * 	which vertex to recompute.
-		 * 	Epsilon is used twice in the algorithm : once to decide whether the
-		 * 	vertex should be recalculated, and a second time when it has been
-		 * 	decided that the vertex should be recalculated, which parent of the
-		 * 	vertex or the vertex itself should be recalculate (see the paper for
-		 * 	more details). This parameter allow to have a different value of
-		 * 	epsilon for the second purpose.
-		 * 	In most of the cases, this is expected to be equal to
-		 *		1, although the implementation is able to deal with a 
-		 * 	different value.
+		 * @param config The settings of the tree, among which epsilon,
+		 * 	min_split_points and min_split_gini. No ownership is taken
 		 * @param is_root Indicates whether this vertex is the root (top vertex)
 		 * 	of the tree
 		 *
@@ -205,29 +729,31 @@ class Vertex {
 		 * @warning Ownership of @p pointset is taken, but not ownership 
 		 * 	of @p parent
 		 */
-		Vertex(PointSet* pointset, Vertex* parent, unsigned int remaining_high, float epsilon, unsigned int min_split_points, float min_split_gini, float epsilon_transmission, bool is_root = false);
+		Vertex(PointSet* pointset, Vertex* parent, unsigned int remaining_high, TreeConfig* config, bool is_root = false);
 
 		/**
 		 * Build new root vertex by copying the provided one
 		 *
-		 * All the data but epsilon and the points are copied from source. The
-		 * new points are expected to be a copy of those in source. This
-		 * This function is used when making several tests, to avoid expensive
-		 * Tree creation
+		 * All the data but the settings and the points are copied from
+		 * source. The new points are expected to be a copy of those in
+		 * source. This function is used when making several tests, to avoid
+		 * expensive Tree creation
 		 *
 		 * @param source Root vertex from which to copy
-		 * @param epsilon New epsilon value for the tree
-		 * @param epsilon_transmission New epsilon_transmission value
+		 * @param config The settings of the new tree. No ownership is taken
 		 * @param new_points Copy of the previous points, owned by the new tree
 		 */
-		Vertex(const Vertex& source, float epsilon, float epsilon_transmission, std::multiset<Point*> new_points);
+		Vertex(const Vertex& source, TreeConfig* config, std::multiset<Point*> new_points);
 
 		/**
-		 * Destructor of Vertex
+		 * Destroy a vertex and give its memory back to the arena of its tree
 		 *
-		 * Free memory of children
+		 * This replaces delete for vertices, which are made by a placement
+		 * new in the VertexArena of their tree.
+		 *
+		 * @param vertex The vertex to destroy, with its subtree
 		 */
-		~Vertex();
+		static void destroy(Vertex* vertex);
 
 		/**
 		 * Build the Vertex
@@ -280,6 +806,57 @@ class Vertex {
 		 */
 		unsigned int delete_point(Point* old_point);
 
+		/**
+		 * Add and delete a batch of points from the pointset of the vertex and
+		 * its children
+		 *
+		 * The pointset is updated with the whole batch, then the rebuild rule
+		 * is checked once, and the batch is split between the children. Hence
+		 * a vertex is rebuilt at most once per batch, and only the highest
+		 * vertex needing a rebuild on each path is rebuilt.
+		 *
+		 * @param updates The points to add (true) or to delete (false), not
+		 * 	empty. The vertex does not take ownership of them. A point should
+		 * 	not be both added and deleted
+		 *
+		 * @return The rebuild threshold, see Vertex#add_point
+		 */
+		unsigned int apply_batch(const std::vector<std::pair<Point*, bool>>& updates);
+
+		/**
+		 * Add or delete a point, concurrently with other threads doing the same
+		 *
+		 * The update goes down the path of the point, locking each vertex
+		 * only while updating it, hence updates along disjoint paths only
+		 * contend on the vertices they share. Each vertex counts the updates
+		 * in progress below it. The training error of the updated leaf is
+		 * then added to the vertices of the path without locking them.
+		 *
+		 * When a vertex needs to be rebuilt, the vertex rebuilt is chosen as
+		 * by Vertex#add_point. It is locked, and rebuilt once the updates in
+		 * progress in its subtree are complete, which is the only exclusive
+		 * access made. The updates coming from above wait for the rebuild
+		 * before entering the subtree.
+		 *
+		 * @param point The point to add or to delete. The vertex does not take
+		 * 	ownership of it
+		 * @param is_add True to add the point, false to delete it
+		 * @warning This should be called on the root, with
+		 * 	TreeConfig#use_concurrent_writers true, a local rebuild policy
+		 * 	(see RebuildPolicy#is_local) and without lazy rebuilds, buffers,
+		 * 	pending rebuilds, pruning nor tombstones. No other method should
+		 * 	be called meanwhile
+		 */
+		void update_concurrently(Point* point, bool is_add);
+
+		/**
+		 * Stop counting an update in progress on this vertex, waking up the
+		 * rebuild waiting for the last one
+		 *
+		 * @see Vertex#update_concurrently
+		 */
+		void release_writer();
+
 
 		/**
 		 * Create a list of string representing the tree from here
@@ -294,11 +871,29 @@ class Vertex {
 		 */
 		std::vector<std::string> to_string();
 
+		/**
+		 * Write the decision of the subtree as C++ code
+		 *
+		 * The code is a statement returning the same decision as
+		 * Vertex#decision, made of nested if over the features array named
+		 * features.
+		 *
+		 * @param out The stream to write the code into
+		 * @param depth The number of tabs of indentation of the code
+		 * @warning The subtree should not have dirty vertices nor buffered
+		 * 	updates, see Vertex#flush
+		 */
+		void export_cpp(std::ostream& out, unsigned int depth);
+
 		/**
 		 * Get the training error
 		 *
 		 * This is the absolute number of points in the pointset of this vertex
 		 * that would not be associated with the right decision if evaluated.
+		 * It is maintained by the updates and builds, hence this is O(1).
+		 *
+		 * @warning The dirty vertices and buffers of the subtree should have
+		 * 	been applied first, see Vertex#flush
 		 */
 		unsigned int get_training_error();
 
@@ -310,6 +905,165 @@ class Vertex {
 		 */
 		bool decision(const float* features);
 
+		/// Get the number of updates made since the last build
+		unsigned int get_updates_since_last_build() {return this->updates_since_last_build;};
+
+		/// Get the size of the pointset on the last build
+		unsigned int get_size_at_building() {return this->size_at_building;};
+
+		/**
+		 * Get the epsilon used by the rebuild rule of the vertex
+		 *
+		 * @see Vertex#refresh_epsilon
+		 */
+		float get_epsilon() {return this->adapted_epsilon;};
+
+		/// Get the number of updates the last build is certified to survive
+		unsigned int get_certified_updates() {return this->certified_updates;};
+
+		/// Indicates whether certificates can delay rebuilds
+		bool get_use_certificate() {return this->config->use_certificate;};
+
+		/**
+		 * Get the gini gain of the current split of the vertex
+		 *
+		 * This is calculated from the current pointsets of the children, in
+		 * constant time.
+		 *
+		 * @return The gain of the split, or 0 if the vertex is a leaf
+		 */
+		double get_split_gain();
+
+		/// Get the proportion of positive points in the pointset of the vertex
+		float get_positive_proportion() {return this->pointset->get_positive_proportion();};
+
+		/**
+		 * Set the policy deciding when to rebuild vertices
+		 *
+		 * The policy is cloned for this vertex and all its descendants, and
+		 * the vertices created by later builds clone the policy of their
+		 * parent. The children of a dirty vertex are left as they are, being
+		 * replaced by its next build.
+		 *
+		 * @param rebuild_policy The policy to clone. No ownership is taken
+		 */
+		void set_rebuild_policy(const RebuildPolicy& rebuild_policy);
+
+		/// Get the policy deciding when to rebuild this vertex
+		const RebuildPolicy& get_rebuild_policy() const {return *this->rebuild_policy;};
+
+		/**
+		 * Apply a change of the epsilon settings of the tree to this vertex
+		 * and all its descendants
+		 *
+		 * Without update time budget, the epsilon of each vertex is reset to
+		 * TreeConfig#epsilon. Else, it is kept within the new bounds, and
+		 * tuned on the next rebuilds.
+		 *
+		 * @see Vertex#adapted_epsilon
+		 */
+		void refresh_epsilon();
+
+		/**
+		 * Change the height left below this vertex, after a change of the
+		 * parameters deciding whether a vertex is a leaf
+		 *
+		 * The split chosen for a vertex does not depend on those parameters,
+		 * hence only the vertices that should become leaves, or leaves that
+		 * should now be split, are rebuilt. The other ones keep their split and
+		 * their update counters.
+		 *
+		 * @param remaining_high The new number of children layers that can
+		 * 	still be added below this vertex
+		 * @see TreeConfig#min_split_points
+		 * @see TreeConfig#min_split_gini
+		 */
+		void reconfigure(unsigned int remaining_high);
+
+		/**
+		 * Build all the dirty vertices of the subtree and apply the buffers
+		 *
+		 * Only the paths to vertices that may be dirty or have buffered
+		 * updates are visited.
+		 */
+		void flush();
+
+		/**
+		 * Enable or disable subset splits of classified features
+		 *
+		 * The setting is applied to the pointsets of this vertex and all its
+		 * descendants, and inherited by the vertices created by later builds.
+		 * The current splits are kept until the next rebuilds. The children
+		 * of a dirty vertex are skipped, as its build splits its pointset.
+		 *
+		 * @param use_subset_splits True to split classified features by
+		 * 	subsets of categories
+		 * @see PointSet#set_use_subset_splits
+		 */
+		void set_use_subset_splits(bool use_subset_splits);
+
+		/**
+		 * Apply a change of TreeConfig#use_pruning to this vertex and all its
+		 * descendants
+		 *
+		 * The uniform vertices are computed again, and all the nodes are
+		 * written again in the FlatTree. A dirty vertex is never uniform,
+		 * hence its children are skipped.
+		 */
+		void refresh_pruning();
+
+		/**
+		 * Apply a change of TreeConfig#use_concurrent_writers to this vertex
+		 * and all its descendants
+		 *
+		 * The {@link #writers writers} locks are created or freed.
+		 */
+		void refresh_writer_locks();
+
+		/**
+		 * Remove the points marked as deleted from all the pointsets of the
+		 * subtree
+		 *
+		 * The walk stops at dirty vertices, whose children may still hold
+		 * points freed since. Their tombstones are dropped by the next build.
+		 */
+		void compact();
+
+		/**
+		 * Append the points of the leaves of the subtree to a vector, leaf by
+		 * leaf from the left
+		 *
+		 * The dirty vertices are considered as leaves, as their children are
+		 * not updated anymore. The points added to the subtree may not be in
+		 * a leaf yet, if they are buffered, and the leaves may still hold
+		 * deleted points, under a vertex whose rebuild is deferred.
+		 *
+		 * @param to_fill The vector to which the points are appended
+		 */
+		void append_leaf_points(std::vector<Point*>& to_fill);
+
+		/**
+		 * Replace the points of all the pointsets of the subtree by copies of
+		 * them stored elsewhere
+		 *
+		 * The pointsets and the buffers are updated, the points that have no
+		 * copy being kept. The children of the dirty vertices are not
+		 * updated anymore, and are skipped.
+		 *
+		 * @param relocated The copy of each point, by point
+		 * @warning The subtree should not have pending rebuilds
+		 * @see PointSet#relocate
+		 */
+		void relocate_points(const std::unordered_map<Point*, Point*>& relocated);
+
+		/**
+		 * Apply the buffers of the subtree that are full, after a reduction
+		 * of TreeConfig#buffer_size
+		 *
+		 * @see Vertex#buffer
+		 */
+		void fit_buffers();
+
 		/**
 		 * Get the number of time a Vertex#build method has been called
 		 *
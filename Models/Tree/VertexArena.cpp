@@ -0,0 +1,40 @@
+#include "VertexArena.h"
+
+#include <cstdint>
+#include "Vertex.h"
+
+VertexArena::VertexArena() :
+	slot_size((sizeof(Vertex) + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT),
+	nb_used_slots(CHUNK_SIZE)
+{}
+
+VertexArena::~VertexArena()
+{
+	for(auto it = this->chunks.begin(); it != this->chunks.end(); it++)
+		delete [] *it;
+}
+
+void* VertexArena::allocate()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	// Last freed first, as it is the most likely to be in cache
+	if(!this->free_slots.empty())
+	{
+		void* slot = this->free_slots.back();
+		this->free_slots.pop_back();
+		return slot;
+	}
+	if(this->nb_used_slots == CHUNK_SIZE)
+	{
+		this->chunks.push_back(new char[CHUNK_SIZE * this->slot_size + SLOT_ALIGNMENT]);
+		this->nb_used_slots = 0;
+	}
+	uintptr_t first_slot = ((uintptr_t)this->chunks.back() + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+	return (void*)(first_slot + this->nb_used_slots++ * this->slot_size);
+}
+
+void VertexArena::release(void* slot)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->free_slots.push_back(slot);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file VertexArena.h
+ * Definition of class VertexArena
+ */
+#ifndef VERTEXARENA_H_INCLUDED
+#define VERTEXARENA_H_INCLUDED
+
+#include <vector>
+#include <mutex>
+#include <cstddef>
+
+/**
+ * Memory of the vertices of a tree
+ *
+ * The vertices are allocated in chunks of #CHUNK_SIZE slots, and the slot of
+ * a freed vertex is kept for the next vertex created, hence a rebuild reuses
+ * the slots of the subtree it replaces. Each slot is aligned on a cache line,
+ * so that the fields read by a walk (see Vertex) are in a single one.
+ *
+ * Only the Vertex objects themselves are in the arena: the pointset, the
+ * rebuild policy, the buffer and the writer lock of each vertex are still
+ * allocated on the heap.
+ *
+ * The memory is only given back when the arena is destroyed.
+ *
+ * @note The arena can be used by the background threads building shadow
+ * 	subtrees, hence it is protected by a mutex
+ */
+class VertexArena {
+	private:
+		/// Number of slots allocated at once
+		static const size_t CHUNK_SIZE = 256;
+
+		/// Alignment of the slots, the size of a cache line
+		static const size_t SLOT_ALIGNMENT = 64;
+
+		/// Size of a slot, sizeof(Vertex) rounded up to #SLOT_ALIGNMENT
+		size_t slot_size;
+
+		/// The chunks, as allocated
+		std::vector<char*> chunks;
+
+		/// Number of slots of the last chunk that have been used at least once
+		size_t nb_used_slots;
+
+		/// The slots of the freed vertices
+		std::vector<void*> free_slots;
+
+		/// Protects all the other attributes
+		std::mutex mutex;
+
+	public:
+		/// Constructor of an empty VertexArena
+		VertexArena();
+
+		/// Copying would free the chunks twice
+		VertexArena(const VertexArena&) = delete;
+
+		/// Copying would free the chunks twice
+		VertexArena& operator=(const VertexArena&) = delete;
+
+		/**
+		 * Destructor of VertexArena
+		 *
+		 * Free memory of all the chunks
+		 *
+		 * @warning All the vertices should have been destroyed
+		 */
+		~VertexArena();
+
+		/**
+		 * Get the memory of a new vertex
+		 *
+		 * @return A slot of sizeof(Vertex) bytes, for a placement new
+		 */
+		void* allocate();
+
+		/**
+		 * Keep the memory of a destroyed vertex for the next ones
+		 *
+		 * @param slot A slot given by VertexArena#allocate
+		 */
+		void release(void* slot);
+};
+#endif // VERTEXARENA_H_INCLUDED
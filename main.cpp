@@ -13,9 +13,12 @@
 #include <map>
 #include <vector>
 #include <chrono>
+#include <thread>
+#include <atomic>
 #include <queue>
 #include <random>
 #include <algorithm>
+#include <functional>
 #include <stdexcept>
 #include "Models/PointSet/Point.h"
 #include "Models/PointSet/PointSet.h"
@@ -50,6 +53,8 @@ enum class event_type{
 	ADD,
 	/// Delete the point from the tree
 	DEL,
+	/// Add the point to the tree in place of the oldest point of the window
+	SLIDE,
 	/// Use the point to evaluate if the tree gives the right answer
 	EVAL};
 
@@ -221,39 +226,200 @@ Point point_from_line(std::string current_line,
 	return to_return;
 }
 
+/**
+ * Count the decision made for an EVAL point in the result
+ *
+ * @param result In/out argument, the data of the EVAL events
+ * @param decision The decision of the tree for the point
+ * @param value The decision value of the point
+ */
+void count_decision(test_result& result, bool decision, bool value)
+{
+	if(decision)
+		if(value)
+			result.true_positive++;
+		else
+			result.false_positive++;
+	else
+		if(value)
+			result.false_negative++;
+		else
+			result.true_negative++;
+}
+
+/**
+ * Make the decisions of a batch of EVAL points and count them
+ *
+ * @param result In/out argument, the data of the EVAL events
+ * @param tree_to_update Tree making the decisions
+ * @param eval_rows In/out argument, the features of the points, one point
+ *  after the other. It is emptied
+ * @param eval_values In/out argument, the decision values of the points. It is
+ *  emptied
+ */
+void count_batch_decisions(test_result& result, Tree& tree_to_update, std::vector<float>& eval_rows, std::vector<bool>& eval_values)
+{
+	if(eval_values.empty())
+		return;
+	bool* decisions = new bool[eval_values.size()];
+	tree_to_update.decision_batch(eval_rows.data(), eval_values.size(), decisions);
+	for(size_t i = 0; i < eval_values.size(); i++)
+		count_decision(result, decisions[i], eval_values[i]);
+	delete [] decisions;
+	eval_rows.clear();
+	eval_values.clear();
+}
+
+/**
+ * Apply a batch of updates with Tree#apply_batch
+ *
+ * @param tree_to_update Tree on which performing the updates
+ * @param to_add In/out argument, the points to add, whose ownership is given
+ *  to the tree. It is emptied
+ * @param to_delete In/out argument, the points to delete. It is emptied
+ */
+void apply_batch_updates(Tree& tree_to_update, std::vector<Point*>& to_add, std::vector<Point>& to_delete)
+{
+	if(to_add.empty() && to_delete.empty())
+		return;
+	tree_to_update.apply_batch(to_add, to_delete);
+	to_add.clear();
+	to_delete.clear();
+}
+
+/**
+ * Perform ADD and DEL events with several writer threads
+ *
+ * The events are dealt to the threads according to the data of their point,
+ * hence the events of equal points are performed in order by the same thread,
+ * and a point is never deleted before being added.
+ *
+ * @param tree_to_update Tree on which performing the events, with concurrent
+ *  writers enabled
+ * @param updates In/out argument, the events to perform, in order. It is
+ *  emptied
+ * @param nb_writer_threads Number of threads performing the events
+ */
+void apply_concurrent_updates(Tree& tree_to_update, std::vector<tree_event*>& updates, unsigned int nb_writer_threads)
+{
+	if(updates.empty())
+		return;
+	std::vector<std::vector<tree_event*>> thread_updates(nb_writer_threads);
+	for(auto it = updates.begin(); it != updates.end(); it++)
+	{
+		size_t hash = (*it)->event_point.get_value();
+		const float* features = (*it)->event_point.get_features();
+		for(size_t i = 0; i < (*it)->event_point.get_dimension(); i++)
+			hash = hash * 31 + std::hash<float>()(features[i]);
+		thread_updates[hash % nb_writer_threads].push_back(*it);
+	}
+	std::vector<std::thread> writers;
+	for(auto it = thread_updates.begin(); it != thread_updates.end(); it++)
+		writers.push_back(std::thread([&tree_to_update, it]()
+			{
+				for(auto event_it = it->begin(); event_it != it->end(); event_it++)
+					if((*event_it)->tree_event_type == event_type::ADD)
+						tree_to_update.add_point((*event_it)->event_point);
+					else
+						tree_to_update.delete_point((*event_it)->event_point);
+			}));
+	for(auto it = writers.begin(); it != writers.end(); it++)
+		it->join();
+	updates.clear();
+}
+
 /**
  * Run the test steps of event_vector
  *
  * @param event_vector Ordered list of events to perform
  * @param tree_to_update Tree on which performing the events
+ * @param eval_batch_size If not 0, the EVAL points are buffered and decided
+ *  together with Tree#decision_batch once this number of them is reached,
+ *  hence on the tree as it is at that time
+ * @param use_quick_scorer If true, the EVAL points that are not batched are
+ *  decided with Tree#quick_decision
+ * @param nb_reader_threads Number of threads deciding the EVAL points in loop
+ *  with Tree#decision while the events are performed, whose decisions are not
+ *  counted. The tree should have concurrent readers enabled if not 0
+ * @param update_batch_size If not 0, the consecutive ADD and DEL events are
+ *  buffered and applied together with Tree#apply_batch once this number of
+ *  them is reached, or before the next EVAL event
+ * @param nb_writer_threads If not 0, the consecutive ADD and DEL events are
+ *  performed by this number of threads at once, before the next EVAL event.
+ *  The tree should have concurrent writers enabled
  * @return Data of the EVAL events
+ * @note The SLIDE events are performed at once with Tree#slide, after the
+ *  ADD and DEL events before them
  * @todo Move this function as a method of Tree
  */
-test_result test_iterations(std::vector<tree_event> event_vector, Tree& tree_to_update)
+test_result test_iterations(std::vector<tree_event> event_vector, Tree& tree_to_update, unsigned int eval_batch_size, bool use_quick_scorer, unsigned int nb_reader_threads, unsigned int update_batch_size, unsigned int nb_writer_threads)
 {
 	test_result result;
+	std::vector<float> eval_rows;
+	std::vector<bool> eval_values;
+	std::vector<Point*> batch_to_add;
+	std::vector<Point> batch_to_delete;
+	std::vector<tree_event*> concurrent_updates;
+	std::vector<const float*> eval_features;
+	for(auto it = event_vector.begin(); it != event_vector.end(); it++)
+		if((*it).tree_event_type == event_type::EVAL)
+			eval_features.push_back((*it).event_point.get_features());
+	std::atomic<bool> are_readers_stopped(eval_features.empty());
+	std::vector<std::thread> readers;
+	for(unsigned int i = 0; i < nb_reader_threads; i++)
+		readers.push_back(std::thread([&tree_to_update, &eval_features, &are_readers_stopped]()
+			{
+				for(size_t j = 0; !are_readers_stopped.load(); j = (j + 1) % eval_features.size())
+					tree_to_update.decision(eval_features[j]);
+			}));
 	for(auto it = event_vector.begin(); it != event_vector.end(); it++)
 	{
-		if((*it).tree_event_type == event_type::ADD)
+		if((*it).tree_event_type == event_type::SLIDE)
+		{
+			apply_concurrent_updates(tree_to_update, concurrent_updates, nb_writer_threads);
+			apply_batch_updates(tree_to_update, batch_to_add, batch_to_delete);
+			tree_to_update.slide(new Point((*it).event_point));
+		}
+		else if(nb_writer_threads > 0 && (*it).tree_event_type != event_type::EVAL)
+			concurrent_updates.push_back(&*it);
+		else if(update_batch_size > 0 && (*it).tree_event_type != event_type::EVAL)
+		{
+			if((*it).tree_event_type == event_type::ADD)
+				batch_to_add.push_back(new Point((*it).event_point));
+			else
+				batch_to_delete.push_back((*it).event_point);
+			if(batch_to_add.size() + batch_to_delete.size() >= update_batch_size)
+				apply_batch_updates(tree_to_update, batch_to_add, batch_to_delete);
+		}
+		else if((*it).tree_event_type == event_type::ADD)
 			tree_to_update.add_point((*it).event_point);
 		else if((*it).tree_event_type == event_type::DEL)
 			tree_to_update.delete_point((*it).event_point);
 		else
 		{
-			bool eval_result = tree_to_update.decision((*it).event_point.get_features());
-			if(eval_result)
-				if((*it).event_point.get_value())
-					result.true_positive++;
-				else
-					result.false_positive++;
+			apply_concurrent_updates(tree_to_update, concurrent_updates, nb_writer_threads);
+			apply_batch_updates(tree_to_update, batch_to_add, batch_to_delete);
+			if(eval_batch_size == 0 && use_quick_scorer)
+				count_decision(result, tree_to_update.quick_decision((*it).event_point.get_features()), (*it).event_point.get_value());
+			else if(eval_batch_size == 0)
+				count_decision(result, tree_to_update.decision((*it).event_point.get_features()), (*it).event_point.get_value());
 			else
-				if((*it).event_point.get_value())
-					result.false_negative++;
-				else
-					result.true_negative++;
+			{
+				const float* features = (*it).event_point.get_features();
+				eval_rows.insert(eval_rows.end(), features, features + (*it).event_point.get_dimension());
+				eval_values.push_back((*it).event_point.get_value());
+				if(eval_values.size() >= eval_batch_size)
+					count_batch_decisions(result, tree_to_update, eval_rows, eval_values);
+			}
 			result.total_training_error += tree_to_update.get_training_error();
 		}
 	}
+	apply_concurrent_updates(tree_to_update, concurrent_updates, nb_writer_threads);
+	apply_batch_updates(tree_to_update, batch_to_add, batch_to_delete);
+	count_batch_decisions(result, tree_to_update, eval_rows, eval_values);
+	are_readers_stopped.store(true);
+	for(auto it = readers.begin(); it != readers.end(); it++)
+		it->join();
 	return result;
 }
 
@@ -402,6 +568,8 @@ Tree random_from_file(std::string file_name,
  * @param epsilon_transmission Epsilon value to use when searching which parent
  *  node to recompute (line 11 of the algorithm 1). It is usually equal to
  *  1 but could be changed for tests.
+ * @param use_slide If true, each sequence of DEL and ADD is made a single
+ *  SLIDE event, and the window of the tree is started (see Tree#slide)
  * @return The inital tree on which to perform the events
  */
 Tree window_from_file(std::string file_name,
@@ -415,12 +583,14 @@ Tree window_from_file(std::string file_name,
 				unsigned int max_height,
 				unsigned int min_split_points,
 				float min_split_gini,
-				float epsilon_transmission)
+				float epsilon_transmission,
+				bool use_slide)
 {
 	size_t dimension;
 	size_t label_position;
     std::multiset<Point*> tree_points;
 	std::queue<Point> points_to_delete;
+	std::vector<Point*> window_points;
 	srand(seed);
     std::fstream data_file(file_name);
     std::string current_line;
@@ -443,6 +613,7 @@ Tree window_from_file(std::string file_name,
 			{
                 Point* new_point = new Point(current_point);
                 tree_points.insert(new_point);
+				window_points.push_back(new_point);
 			}
 			else
 			{
@@ -451,18 +622,29 @@ Tree window_from_file(std::string file_name,
 					tree_event new_event(Point(current_point), event_type::EVAL);
 					event_vector.push_back(new_event);
 				}
-				tree_event del_event(points_to_delete.front(), event_type::DEL);
-				event_vector.push_back(del_event);
+				if(use_slide)
+				{
+					tree_event slide_event(Point(current_point), event_type::SLIDE);
+					event_vector.push_back(slide_event);
+				}
+				else
+				{
+					tree_event del_event(points_to_delete.front(), event_type::DEL);
+					event_vector.push_back(del_event);
+					tree_event add_event(Point(current_point), event_type::ADD);
+					event_vector.push_back(add_event);
+				}
 				points_to_delete.pop();
-				tree_event add_event(Point(current_point), event_type::ADD);
-				event_vector.push_back(add_event);
 			}
         }
     }
     else
         throw std::runtime_error("Error when oppening the data file");
     data_file.close();
-    return Tree(tree_points, dimension, max_height, epsilon, min_split_points, min_split_gini, epsilon_transmission, features_types);
+	Tree initial_tree(tree_points, dimension, max_height, epsilon, min_split_points, min_split_gini, epsilon_transmission, features_types);
+	if(use_slide)
+		initial_tree.set_window(window_points);
+	return initial_tree;
 }
 
 /**
@@ -504,6 +686,9 @@ Tree window_from_file(std::string file_name,
  * @param epsilon_transmission Epsilon value to use when searching which parent
  *  node to recompute (line 11 of the algorithm 1). It is usually equal to
  *  1 but could be changed for tests.
+ * @param use_slide If true, each sequence of DEL and ADD of the sliding window
+ *  experiment is made a single SLIDE event. Relevant only for tests of the
+ *  sliding window kind.
  * @return The inital tree on which to perform the events
  */
 Tree branched_from_file(std::string file_name,
@@ -519,7 +704,8 @@ Tree branched_from_file(std::string file_name,
 	algo_type type_of_building,
 	unsigned int min_split_points,
 	float min_split_gini,
-	float epsilon_transmission)
+	float epsilon_transmission,
+	bool use_slide)
 {
 	if (type_of_building == algo_type::SLIDING)
 		return window_from_file(file_name,
@@ -534,7 +720,8 @@ Tree branched_from_file(std::string file_name,
 			max_height,
 			min_split_points,
 			min_split_gini,
-			epsilon_transmission);
+			epsilon_transmission,
+			use_slide);
 	else
 		return random_from_file(file_name,
 			label_true_value,
@@ -586,6 +773,40 @@ int main(int argc, char *argv[])
 	float epsilon = parameters_parser.get_value("epsilon") == "-1" ? std::min(std::min(max_gain_error/13, min_split_gini/6),  float(1)/(min_split_points + 2)) : std::stof(parameters_parser.get_value("epsilon"));
 	float epsilon_transmission = parameters_parser.get_value("epsilon_transmission") == "-1" ? epsilon : std::stof(parameters_parser.get_value("epsilon_transmission"));
 	float epsilon_max = parameters_parser.get_value("epsilon_max") == "-1" ? epsilon : std::stof(parameters_parser.get_value("epsilon_max"));
+	bool use_certificate = parameters_parser.get_value("certificate") == BOOLEAN_TRUE_VALUE;
+	unsigned long rebuild_budget = std::stoul(parameters_parser.get_value("rebuild_budget"));
+	unsigned int async_min_size = (unsigned int)std::stoul(parameters_parser.get_value("async_min_size"));
+	float max_pending_lag = std::stof(parameters_parser.get_value("max_pending_lag"));
+	bool is_lazy = parameters_parser.get_value("lazy") == BOOLEAN_TRUE_VALUE;
+	unsigned int buffer_size = (unsigned int)std::stoul(parameters_parser.get_value("buffer_size"));
+	bool use_tombstones = parameters_parser.get_value("tombstones") == BOOLEAN_TRUE_VALUE;
+	bool use_pruning = parameters_parser.get_value("pruning") == BOOLEAN_TRUE_VALUE;
+	bool use_subset_splits = parameters_parser.get_value("subset_splits") == BOOLEAN_TRUE_VALUE;
+	unsigned int eval_batch_size = (unsigned int)std::stoul(parameters_parser.get_value("eval_batch_size"));
+	bool use_quick_scorer = parameters_parser.get_value("quick_scorer") == BOOLEAN_TRUE_VALUE;
+	std::string export_file_name = parameters_parser.get_value("export_cpp");
+	unsigned int nb_reader_threads = (unsigned int)std::stoul(parameters_parser.get_value("reader_threads"));
+	std::string shared_memory_name = parameters_parser.get_value("shared_memory");
+	float relocation_ratio = std::stof(parameters_parser.get_value("relocation_ratio"));
+	unsigned int update_batch_size = (unsigned int)std::stoul(parameters_parser.get_value("update_batch_size"));
+	unsigned int parallel_depth = (unsigned int)std::stoul(parameters_parser.get_value("parallel_depth"));
+	unsigned int nb_writer_threads = (unsigned int)std::stoul(parameters_parser.get_value("writer_threads"));
+	bool use_slide = parameters_parser.get_value("slide") == BOOLEAN_TRUE_VALUE;
+	double update_time_budget = std::stod(parameters_parser.get_value("update_time_budget"));
+	bool is_adaptive_epsilon_max_default = parameters_parser.get_value("adaptive_epsilon_max") == "-1";
+	float adaptive_epsilon_max = is_adaptive_epsilon_max_default ? -1 : std::stof(parameters_parser.get_value("adaptive_epsilon_max"));
+	double drift_delta = std::stod(parameters_parser.get_value("drift_delta"));
+	double drift_lambda = std::stod(parameters_parser.get_value("drift_lambda"));
+	unsigned int drift_min_updates = (unsigned int)std::stoul(parameters_parser.get_value("drift_min_updates"));
+	RebuildPolicy* rebuild_policy;
+	if(parameters_parser.get_value("rebuild_policy") == "E" || parameters_parser.get_value("rebuild_policy") == "EPSILON")
+		rebuild_policy = new EpsilonRebuildPolicy();
+	else if(parameters_parser.get_value("rebuild_policy") == "D" || parameters_parser.get_value("rebuild_policy") == "DRIFT")
+		rebuild_policy = new DriftRebuildPolicy(drift_delta, drift_lambda, drift_min_updates);
+	else
+		throw std::runtime_error("Unknown rebuild policy : " + parameters_parser.get_value("rebuild_policy"));
+	if(use_slide && nb_writer_threads > 0)
+		throw std::runtime_error("Error : the window can not slide with concurrent writers");
     std::vector<tree_event> event_vector;
 
     const auto t1 = std::chrono::high_resolution_clock::now();
@@ -605,7 +826,8 @@ int main(int argc, char *argv[])
 				current_algo_type,
 				min_split_points,
 				min_split_gini,
-				epsilon_transmission);
+				epsilon_transmission,
+				use_slide);
 
     const auto t2 = std::chrono::high_resolution_clock::now();
 
@@ -616,11 +838,33 @@ int main(int argc, char *argv[])
 	{
 		epsilon_transmission = parameters_parser.get_value("epsilon_transmission") == "-1" ? current_epsilon : epsilon_transmission;
 		Tree current_tree(reference_tree, current_epsilon, epsilon_transmission);
+		current_tree.set_use_certificate(use_certificate);
+		current_tree.set_rebuild_budget(rebuild_budget);
+		current_tree.set_rebuild_policy(*rebuild_policy);
+		current_tree.set_async_min_size(async_min_size);
+		current_tree.set_max_pending_lag(max_pending_lag);
+		current_tree.set_parallel_depth(parallel_depth);
+		current_tree.set_adaptive_epsilon(update_time_budget, is_adaptive_epsilon_max_default ? std::max(max_gain_error/13, 2*current_epsilon) : adaptive_epsilon_max);
+		current_tree.set_lazy(is_lazy);
+		current_tree.set_buffer_size(buffer_size);
+		current_tree.set_use_tombstones(use_tombstones);
+		current_tree.set_use_pruning(use_pruning);
+		current_tree.set_use_subset_splits(use_subset_splits);
+		current_tree.set_concurrent_readers(nb_reader_threads > 0);
+		current_tree.set_shared_memory(shared_memory_name);
+		current_tree.set_relocation_ratio(relocation_ratio);
+		current_tree.set_concurrent_writers(nb_writer_threads > 0);
 		Vertex::reset_nb_build();
 		const auto t3 = std::chrono::high_resolution_clock::now();
-		 test_result result = test_iterations(event_vector, current_tree);
+		 test_result result = test_iterations(event_vector, current_tree, eval_batch_size, use_quick_scorer, nb_reader_threads, update_batch_size, nb_writer_threads);
 		const auto t4 = std::chrono::high_resolution_clock::now();
 
+		if(!export_file_name.empty())
+		{
+			std::ofstream export_file(export_file_name);
+			current_tree.export_cpp(export_file);
+		}
+
 		if(is_output_csv)
 			std::cout << seed << ";" << current_epsilon << ";" << result.true_positive << ";" << result.true_negative << ";" << result.false_positive << ";" << result.false_negative;
 		else
@@ -643,5 +887,6 @@ int main(int argc, char *argv[])
 			std::cout << "Mean training error : " << (double)result.total_training_error / (result.true_positive + result.true_negative + result.false_positive + result.false_negative) << std::endl;
 		}
 	}
+	delete rebuild_policy;
     return 0;
 }